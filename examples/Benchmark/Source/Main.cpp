@@ -0,0 +1,504 @@
+#include <x2d/x2d.h>
+using namespace xd;
+
+// Calls func a number of times and returns the average time in milliseconds
+template<typename Func>
+double measure(Func func, const uint iterations = 10)
+{
+	Timer timer;
+	timer.start();
+	for(uint i = 0; i < iterations; ++i)
+	{
+		func();
+	}
+	timer.stop();
+	return timer.getElapsedTime() * 1000.0 / iterations;
+}
+
+class BenchmarkGame : public Game
+{
+public:
+	void start(GraphicsContext &graphicsContext)
+	{
+		LOG("** x2D Benchmarks **");
+
+		for(uint i = 0; i < 8; ++i)
+		{
+			uchar pixel[4] = { 255, 255, 255, 255 };
+			m_textures.push_back(Texture2DPtr(new Texture2D(1, 1, pixel)));
+		}
+
+		benchmarkSpriteSorting(graphicsContext, 1000);
+		benchmarkSpriteSorting(graphicsContext, 10000);
+		benchmarkSpriteSorting(graphicsContext, 100000);
+
+		benchmarkSpriteTransform(1000);
+		benchmarkSpriteTransform(10000);
+		benchmarkSpriteTransform(100000);
+
+		benchmarkParticles(graphicsContext, 100000);
+
+		benchmarkPrimitives(graphicsContext, 1000);
+
+		benchmarkVertexWrites(100000);
+
+		benchmarkRenderTargets(graphicsContext, 8);
+		benchmarkRenderTargetSwitching(graphicsContext, 50);
+
+		benchmarkSoftwareRasterizer(10000);
+
+		// Run with -headless to benchmark without a GPU
+		if(GLRecorder::isInstalled())
+		{
+			const GLRecorder::Recording &recording = GLRecorder::getRecording();
+			LOG("Headless: %i GL calls, %i draw calls, %i vertices, %i KB uploaded to buffers",
+				recording.glCalls, recording.drawCalls.size(), recording.vertexCount, (uint) (recording.bufferUploadBytes / 1024));
+
+			checkHeadless(graphicsContext);
+		}
+
+		Engine::exit();
+	}
+
+private:
+	// Checks that headless mode runs the window, input and drawing paths
+	// without a window, and supports what the recorder implements
+	void checkHeadless(GraphicsContext &graphicsContext)
+	{
+		bool passed = true;
+
+		Window::setSize(320, 240);
+		Window::setPosition(Window::getPosition());
+		Window::minimize();
+		Window::restore();
+		Input::setCursorPos(Vector2i(0, 0));
+		Input::setClipboardString(Input::getClipboardString());
+		Graphics::setVsync(0);
+		if(Window::getSize() != Vector2i(320, 240) || graphicsContext.getWidth() != 320 || graphicsContext.getHeight() != 240)
+		{
+			LOG("Headless check: Window::setSize() didn't resize the viewport");
+			passed = false;
+		}
+
+		if(!Graphics::isInstancingSupported() || !Graphics::isGLVersionSupported(3, 3))
+		{
+			LOG("Headless check: OpenGL 3.3 features are disabled");
+			passed = false;
+		}
+
+		// Draw one instanced sprite and look for the draw call
+		GLRecorder::clearRecording();
+		SpriteBatch spriteBatch(graphicsContext);
+		spriteBatch.begin(SpriteBatch::State(SpriteBatch::DEFERRED, BlendState::PRESET_ALPHA_BLEND, Matrix4(), nullptr, true));
+		spriteBatch.drawSprite(createSprites(1)[0]);
+		spriteBatch.end();
+
+		const GLRecorder::Recording &recording = GLRecorder::getRecording();
+		if(recording.drawCalls.size() != 1 || recording.drawCalls[0].instanceCount != 1)
+		{
+			LOG("Headless check: Expected one instanced draw call, got %i draw calls", recording.drawCalls.size());
+			passed = false;
+		}
+
+		LOG("Headless check %s", passed ? "passed" : "FAILED");
+	}
+
+	// Sprites with mixed depths and textures
+	vector<Sprite> createSprites(const uint count)
+	{
+		Random random;
+		random.setSeed(1337);
+
+		vector<Sprite> sprites(count);
+		for(uint i = 0; i < count; ++i)
+		{
+			sprites[i].setTexture(m_textures[random.nextInt(m_textures.size() - 1)]);
+			sprites[i].setDepth((float) random.nextInt(7));
+			sprites[i].setPosition((float) random.nextInt(800), (float) random.nextInt(600));
+			sprites[i].setSize(16.0f, 16.0f);
+		}
+		return sprites;
+	}
+
+	// Compares the map/list bucketing SpriteBatch used to do per frame with
+	// a SpriteBatch frame in each sorting mode. IMMEDIATE doesn't sort.
+	void benchmarkSpriteSorting(GraphicsContext &graphicsContext, const uint spriteCount)
+	{
+		vector<Sprite> sprites = createSprites(spriteCount);
+
+		uint mapDrawCount = 0;
+		double mapTime = measure([&]()
+		{
+			map<float, map<Texture2DPtr, list<const Sprite*>>> layerTextureMap;
+			for(uint i = 0; i < spriteCount; ++i)
+			{
+				layerTextureMap[sprites[i].getDepth()][sprites[i].getTexture()].push_back(&sprites[i]);
+			}
+
+			mapDrawCount = 0;
+			for(map<float, map<Texture2DPtr, list<const Sprite*>>>::iterator itr1 = layerTextureMap.begin(); itr1 != layerTextureMap.end(); ++itr1)
+			{
+				mapDrawCount += itr1->second.size();
+			}
+		});
+		LOG("Sprite sorting, %i sprites: map %.3f ms (%i draws)", spriteCount, mapTime, mapDrawCount);
+
+		const SpriteBatch::SpriteSortMode modes[4] = { SpriteBatch::DEFERRED, SpriteBatch::BACK_TO_FRONT, SpriteBatch::FRONT_TO_BACK, SpriteBatch::TEXTURE };
+		const char *modeNames[4] = { "DEFERRED", "BACK_TO_FRONT", "FRONT_TO_BACK", "TEXTURE" };
+		SpriteBatch spriteBatch(graphicsContext);
+		spriteBatch.setMaxCapacity(spriteCount);
+		for(uint i = 0; i < 4; ++i)
+		{
+			// The first frame grows the batch to fit the sprites
+			double sortTime = 0.0;
+			uint frameCount = 0;
+			auto frame = [&]()
+			{
+				spriteBatch.begin(SpriteBatch::State(modes[i]));
+				for(uint j = 0; j < spriteCount; ++j)
+				{
+					spriteBatch.drawSprite(sprites[j]);
+				}
+				spriteBatch.end();
+				sortTime += spriteBatch.getStats().sortTime;
+				++frameCount;
+			};
+			frame();
+			sortTime = 0.0;
+			frameCount = 0;
+
+			double batchTime = measure(frame);
+			LOG("Sprite sorting, %i sprites: SpriteBatch %s %.3f ms per frame, %.3f ms sorting (%i draws)",
+				spriteCount, modeNames[i], batchTime, sortTime * 1000.0 / frameCount, spriteBatch.getStats().drawCalls);
+		}
+	}
+
+	// Compares transforming sprite quads with a Matrix4 per sprite, the way
+	// Sprite::getAABB() used to, against transformSpriteQuads().
+	void benchmarkSpriteTransform(const uint spriteCount)
+	{
+		Random random;
+		random.setSeed(1337);
+
+		vector<float> components[9];
+		for(uint j = 0; j < 9; ++j)
+		{
+			components[j].resize(spriteCount);
+		}
+
+		for(uint i = 0; i < spriteCount; ++i)
+		{
+			components[0][i] = (float) random.nextInt(800);
+			components[1][i] = (float) random.nextInt(600);
+			components[2][i] = components[3][i] = 16.0f;
+			components[4][i] = components[5][i] = 8.0f;
+			components[6][i] = components[7][i] = 1.0f;
+			components[8][i] = (float) random.nextInt(360);
+		}
+
+		vector<Vector2> matrixCorners(spriteCount * 4);
+		double matrixTime = measure([&]()
+		{
+			for(uint i = 0; i < spriteCount; ++i)
+			{
+				Matrix4 mat;
+				mat.scale(components[2][i], components[3][i], 1.0f);
+				mat.translate(-components[4][i], -components[5][i], 0.0f);
+				mat.scale(components[6][i], components[7][i], 1.0f);
+				mat.rotateZ(components[8][i]);
+				mat.translate(components[0][i] + components[4][i], components[1][i] + components[5][i], 0.0f);
+				for(uint j = 0; j < 4; ++j)
+				{
+					matrixCorners[i * 4 + j] = (mat * QUAD_VERTICES[j]).getXY();
+				}
+			}
+		});
+
+		const SpriteTransformArrays transforms = {
+			components[0].data(), components[1].data(), components[2].data(), components[3].data(),
+			components[4].data(), components[5].data(), components[6].data(), components[7].data(), components[8].data()
+		};
+
+		vector<float> corners(spriteCount * 8);
+		double kernelTime = measure([&]()
+		{
+			transformSpriteQuads(transforms, spriteCount, corners.data());
+		});
+
+		float maxError = 0.0f;
+		for(uint i = 0; i < spriteCount * 4; ++i)
+		{
+			maxError = max(maxError, max(fabsf(matrixCorners[i].x - corners[i * 2]), fabsf(matrixCorners[i].y - corners[i * 2 + 1])));
+		}
+
+		LOG("Sprite transform, %i sprites: matrix %.3f ms, kernel %.3f ms (max error %f)", spriteCount, matrixTime, kernelTime, maxError);
+	}
+
+	// Compares moving and drawing particles as Sprite objects through
+	// SpriteBatch::drawSprite() against a ParticleSystem.
+	void benchmarkParticles(GraphicsContext &graphicsContext, const uint particleCount)
+	{
+		const float dt = 1.0f / 60.0f;
+		SpriteBatch spriteBatch(graphicsContext);
+
+		ParticleEmitter emitter;
+		emitter.position.set(400.0f, 300.0f);
+		emitter.minSpeed = 10.0f;
+		emitter.maxSpeed = 100.0f;
+		emitter.minLife = emitter.maxLife = 1000.0f;
+
+		Random random;
+		random.setSeed(1337);
+
+		vector<Sprite> sprites(particleCount);
+		vector<Vector2> velocities(particleCount);
+		for(uint i = 0; i < particleCount; ++i)
+		{
+			const float angle = math::degToRad((float) random.nextDouble(360.0));
+			const float speed = (float) random.nextDouble(emitter.minSpeed, emitter.maxSpeed);
+			sprites[i].setTexture(m_textures[0]);
+			sprites[i].setPosition(emitter.position);
+			sprites[i].setSize(4.0f, 4.0f);
+			velocities[i].set(cosf(angle) * speed, sinf(angle) * speed);
+		}
+
+		double spriteUpdateTime = measure([&]()
+		{
+			for(uint i = 0; i < particleCount; ++i)
+			{
+				sprites[i].setPosition(sprites[i].getPosition() + velocities[i] * dt);
+			}
+		});
+
+		double spriteDrawTime = measure([&]()
+		{
+			spriteBatch.begin();
+			for(uint i = 0; i < particleCount; ++i)
+			{
+				spriteBatch.drawSprite(sprites[i]);
+			}
+			spriteBatch.end();
+		});
+
+		ParticleSystem particles(particleCount);
+		particles.getRandom().setSeed(1337);
+		particles.setTexture(m_textures[0]);
+		particles.setSize(4.0f, 4.0f);
+		particles.emit(emitter, particleCount);
+
+		double particleUpdateTime = measure([&]()
+		{
+			particles.update(dt);
+		});
+
+		double particleDrawTime = measure([&]()
+		{
+			spriteBatch.begin();
+			spriteBatch.drawParticles(particles);
+			spriteBatch.end();
+		});
+
+		LOG("Particles, %i particles: sprites %.3f ms update, %.3f ms draw; particle system %.3f ms update, %.3f ms draw (%i draws, %i GL calls)",
+			particleCount, spriteUpdateTime, spriteDrawTime, particleUpdateTime, particleDrawTime, spriteBatch.getStats().drawCalls, spriteBatch.getStats().glCalls);
+	}
+
+	// Compares drawing rectangles and circles one draw call at a time through
+	// the graphics context against a PrimitiveBatch.
+	void benchmarkPrimitives(GraphicsContext &graphicsContext, const uint primitiveCount)
+	{
+		double contextTime = measure([&]()
+		{
+			for(uint i = 0; i < primitiveCount; ++i)
+			{
+				graphicsContext.drawRectangle((float) (i % 40) * 20.0f, (float) (i / 40) * 20.0f, 16.0f, 16.0f, Color(255, 0, 0, 255));
+				graphicsContext.drawCircle((float) (i % 40) * 20.0f + 8.0f, (float) (i / 40) * 20.0f + 8.0f, 4.0f, 16, Color(0, 255, 0, 255));
+			}
+		});
+
+		PrimitiveBatch primitiveBatch(graphicsContext);
+		double batchTime = measure([&]()
+		{
+			primitiveBatch.begin();
+			for(uint i = 0; i < primitiveCount; ++i)
+			{
+				primitiveBatch.drawRectangle(Rect((float) (i % 40) * 20.0f, (float) (i / 40) * 20.0f, 16.0f, 16.0f), Color(255, 0, 0, 255));
+				primitiveBatch.drawCircle(Vector2((float) (i % 40) * 20.0f + 8.0f, (float) (i / 40) * 20.0f + 8.0f), 4.0f, 16, Color(0, 255, 0, 255));
+			}
+			primitiveBatch.end();
+		});
+
+		LOG("Primitives, %i rectangles and circles: context %.3f ms (%i draws), primitive batch %.3f ms (%i draws)",
+			primitiveCount, contextTime, primitiveCount * 2, batchTime, primitiveBatch.getDrawCallCount());
+	}
+
+	// Compares filling Vertex objects, which look up the format on every
+	// write, against the vertices of a compile-time VertexLayout
+	void benchmarkVertexWrites(const uint vertexCount)
+	{
+		typedef VertexLayout<Position2f, Color4ub, TexCoord2f> Layout;
+		Vertex *vertices = Layout::getFormat().createVertices(vertexCount);
+		double vertexTime = measure([&]()
+		{
+			for(uint i = 0; i < vertexCount; ++i)
+			{
+				vertices[i].set4f(VERTEX_POSITION, (float) i, (float) i);
+				vertices[i].set4ub(VERTEX_COLOR, 255, 255, 255, 255);
+				vertices[i].set4f(VERTEX_TEX_COORD, 0.0f, 1.0f);
+			}
+		});
+		delete[] vertices;
+
+		vector<Layout::Vertex> layoutVertices(vertexCount);
+		double layoutTime = measure([&]()
+		{
+			for(uint i = 0; i < vertexCount; ++i)
+			{
+				layoutVertices[i].set<Position2f>((float) i, (float) i);
+				layoutVertices[i].set<Color4ub>(255, 255, 255, 255);
+				layoutVertices[i].set<TexCoord2f>(0.0f, 1.0f);
+			}
+		});
+
+		LOG("Vertex writes, %i vertices: Vertex %.3f ms, VertexLayout %.3f ms (%i byte stride)",
+			vertexCount, vertexTime, layoutTime, Layout::stride);
+	}
+
+	// Compares a chain of effects creating their own render targets, the way
+	// post-processing used to, against a render graph drawing from a pool
+	void benchmarkRenderTargets(GraphicsContext &graphicsContext, const uint effectCount)
+	{
+		double createTime = measure([&]()
+		{
+			RenderTarget2D *source = new RenderTarget2D(800, 600);
+			for(uint i = 0; i < effectCount; ++i)
+			{
+				RenderTarget2D *target = new RenderTarget2D(800, 600);
+				graphicsContext.setRenderTarget(target);
+				graphicsContext.setTexture(source->getTexture());
+				graphicsContext.drawRectangle(0.0f, 0.0f, 800.0f, 600.0f);
+				graphicsContext.setRenderTarget(nullptr);
+				delete source;
+				source = target;
+			}
+			delete source;
+		});
+		graphicsContext.setTexture(nullptr);
+
+		RenderTargetPool pool;
+		RenderGraph renderGraph(pool);
+		uint source = renderGraph.createTarget(800, 600);
+		renderGraph.addPass("source", source, [](GraphicsContext &context, const RenderGraph&) { context.clear(GraphicsContext::COLOR_BUFFER); });
+		for(uint i = 0; i < effectCount; ++i)
+		{
+			const uint target = i + 1 < effectCount ? renderGraph.createTarget(800, 600) : renderGraph.importTarget(nullptr);
+			const uint pass = renderGraph.addPass("effect", target, [source](GraphicsContext &context, const RenderGraph &graph)
+			{
+				context.setTexture(graph.getTexture(source));
+				context.drawRectangle(0.0f, 0.0f, 800.0f, 600.0f);
+			});
+			renderGraph.addInput(pass, source);
+			source = target;
+		}
+
+		// The first execute allocates the pooled targets. Time the frames after it.
+		renderGraph.execute(graphicsContext);
+		pool.endFrame();
+		double graphTime = measure([&]()
+		{
+			renderGraph.execute(graphicsContext);
+			pool.endFrame();
+		}, 60);
+		graphicsContext.setTexture(nullptr);
+
+		LOG("Render targets, %i effects: created per effect %.3f ms, render graph %.3f ms (%i pooled targets, %i target switches)",
+			effectCount, createTime, graphTime, pool.getTargetCount(), renderGraph.getTargetSwitchCount());
+	}
+
+	// Compares ping-ponging between two targets with setRenderTarget(), which
+	// resets the viewport and transform, against switchRenderTarget()
+	void benchmarkRenderTargetSwitching(GraphicsContext &graphicsContext, const uint switchCount)
+	{
+		RenderTarget2D target0(256, 256), target1(256, 256);
+		RenderTarget2D *targets[2] = { &target0, &target1 };
+		uint setGlCalls = 0, switchGlCalls = 0;
+
+		double setTime = measure([&]()
+		{
+			const uint glCalls = graphicsContext.getStats().glCalls;
+			for(uint i = 0; i < switchCount; ++i)
+			{
+				graphicsContext.setRenderTarget(targets[i % 2]);
+				graphicsContext.drawRectangle(0.0f, 0.0f, 16.0f, 16.0f);
+			}
+			graphicsContext.setRenderTarget(nullptr);
+			setGlCalls = graphicsContext.getStats().glCalls - glCalls;
+		});
+
+		double switchTime = measure([&]()
+		{
+			const uint glCalls = graphicsContext.getStats().glCalls;
+			for(uint i = 0; i < switchCount; ++i)
+			{
+				graphicsContext.switchRenderTarget(targets[i % 2]);
+				graphicsContext.drawRectangle(0.0f, 0.0f, 16.0f, 16.0f);
+			}
+			graphicsContext.setRenderTarget(nullptr);
+			switchGlCalls = graphicsContext.getStats().glCalls - glCalls;
+		});
+
+		LOG("Render target switching, %i switches: set %.3f ms (%i GL calls), switch %.3f ms (%i GL calls)",
+			switchCount, setTime, setGlCalls, switchTime, switchGlCalls);
+	}
+
+	// Renders a 1080p scene of blended, textured rectangles on the CPU
+	void benchmarkSoftwareRasterizer(const uint rectangleCount)
+	{
+		Random random;
+		random.setSeed(1337);
+
+		DrawList drawList(1920, 1080);
+		GraphicsContext &context = drawList.getGraphicsContext();
+		context.clear(GraphicsContext::COLOR_BUFFER, Color(0, 0, 0, 255));
+		for(uint i = 0; i < rectangleCount; ++i)
+		{
+			context.setTexture(m_textures[i % m_textures.size()]);
+			context.drawRectangle((float) random.nextInt(1920), (float) random.nextInt(1080), 64.0f, 64.0f, Color(255, 255, 255, 128));
+		}
+
+		SoftwareRasterizer rasterizer(1920, 1080);
+		uchar pixel[4] = { 255, 255, 255, 255 };
+		for(uint i = 0; i < m_textures.size(); ++i)
+		{
+			rasterizer.setTexturePixmap(m_textures[i].get(), Pixmap(1, 1, pixel));
+		}
+
+		double renderTime = measure([&]()
+		{
+			rasterizer.render(drawList);
+		});
+
+		LOG("Software rasterizer, %i rectangles at 1920x1080: %.3f ms (%i triangles)",
+			rectangleCount, renderTime, rasterizer.getTriangleCount());
+	}
+
+	vector<Texture2DPtr> m_textures;
+};
+
+// Main entry point
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, INT)
+{
+	// Setup game
+	BenchmarkGame game;
+
+	// Create engine
+	Engine *engine = CreateEngine();
+	if(engine->init(&game) != X2D_OK)
+	{
+		delete engine;
+		return -1;
+	}
+
+	int r = engine->run();
+	delete engine;
+	return r;
+}
@@ -64,11 +64,14 @@
 	#include <sstream>
 	#include <thread>
 	#include <mutex>
+	#include <condition_variable>
+	#include <atomic>
 	#include <assert.h>
 	#include <fstream>
 	#include <sstream>
 	#include <memory>
 	#include <queue>
+	#include <type_traits>
 	#include "..\3rdparty\gl3w\include\GL\gl3w.h"
 	#include "..\3rdparty\gl3w\include\GL\wglext.h"
 	#include "..\3rdparty\glfw\include\GLFW\glfw3.h"
@@ -134,7 +137,8 @@ enum EngineFlag
 	XD_SHOW_WARININGS	=	1 << 1,
 	XD_RUN_IN_BACKGROUND  = 1 << 2,
 	XD_BLOCK_BACKGROUND_INPUT = 1 << 3,
-	XD_VERBOSE = 1 << 4
+	XD_VERBOSE = 1 << 4,
+	XD_HEADLESS = 1 << 5 // No window. GL calls go to the GLRecorder.
 };
 
 /*********************************************************************
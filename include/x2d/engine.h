@@ -101,6 +101,49 @@ public:
 	virtual void cleanupThread() = 0;
 };
 
+/*********************************************************************
+**	Worker pool														**
+**********************************************************************/
+class XDAPI WorkerPool
+{
+public:
+	// Creates threadCount worker threads. By default one less than the number of cores.
+	WorkerPool(const int threadCount = -1);
+	~WorkerPool();
+
+	uint getThreadCount() const { return m_threads.size(); }
+
+	// Splits [0, count) into chunks of chunkSize and calls func(begin, end) for each chunk
+	// on the workers and the calling thread. Returns when all chunks are done.
+	//
+	// The pool runs one job at a time and is not reentrant. A parallelFor() made while
+	// another one is running, from another thread or from inside func, does not wait
+	// for the workers: it runs all of its chunks serially on the calling thread.
+	// Threads that need parallel jobs at the same time should use their own pools.
+	void parallelFor(const uint count, const uint chunkSize, const function<void(uint, uint)> &func);
+
+private:
+	void workerMain();
+	void runChunks();
+
+	vector<thread> m_threads;
+	mutex m_jobMutex;
+	mutex m_mutex;
+	condition_variable m_workCondition;
+	condition_variable m_doneCondition;
+
+	// Current job
+	const function<void(uint, uint)> *m_func;
+	uint m_count;
+	uint m_chunkSize;
+	atomic<uint> m_nextChunk;
+
+	// Every worker checks in once per job
+	uint m_job;
+	uint m_pendingWorkers;
+	bool m_quit;
+};
+
 /*********************************************************************
 **	File reader class												**
 **********************************************************************/
@@ -275,8 +318,9 @@ public:
 	//static void maximize();
 
 private:
-	// The window handle
+	// The window handle. Null when running headless.
 	static GLFWwindow *s_window;
+	static Vector2i s_headlessSize;
 
 	// Cached list of resolutions
 	//static vector<Vector2i> s_resolutions;
@@ -382,6 +426,7 @@ public:
 	static bool isEnabled(const EngineFlag flag);
 	static string getWorkingDirectory() { return s_game->getWorkDir(); }
 	static string getSaveDirectory() { return s_game->getSaveDir(); }
+	static WorkerPool *getWorkerPool() { return s_workerPool; }
 
 private:
 	
@@ -389,6 +434,7 @@ private:
 	static bool s_initialized;
 	static bool s_paused;
 	static bool s_running;
+	static bool s_exiting;
 	
 	FileSystem		*m_fileSystem;
 	Graphics		*m_graphics;
@@ -398,6 +444,9 @@ private:
 
 	// Game
 	static Game * s_game;
+
+	// Worker threads
+	static WorkerPool *s_workerPool;
 };
 
 XDAPI Engine *CreateEngine();
@@ -1,18 +1,28 @@
 #include "config.h"
 #include "graphics/graphicsContext.h"
+#include "graphics/drawList.h"
 #include "graphics/blendState.h"
 #include "graphics/animation.h"
 #include "graphics/spritebatch.h"
+#include "graphics/spriteCache.h"
 #include "graphics/font.h"
+#include "graphics/frameCapture.h"
+#include "graphics/glRecorder.h"
 #include "graphics/rendertarget.h"
+#include "graphics/particleSystem.h"
 #include "graphics/pixmap.h"
+#include "graphics/primitiveBatch.h"
+#include "graphics/renderGraph.h"
 #include "graphics/shader.h"
 #include "graphics/shape.h"
+#include "graphics/softwareRasterizer.h"
 #include "graphics/sprite.h"
 #include "graphics/texture.h"
 #include "graphics/textureatlas.h"
 #include "graphics/textureregion.h"
+#include "graphics/tileMap.h"
 #include "graphics/vertex.h"
+#include "graphics/vertexLayout.h"
 #include "graphics/vertexbuffer.h"
 #include "graphics/viewport.h"
 
@@ -28,6 +38,9 @@
 		} \
 	}
 
+// Counts the GL calls made by the graphics context and the buffers it draws from
+#define GL_CALL(call) (++GraphicsContext::s_glCallCount, call)
+
 /*********************************************************************
 **	Graphics class [static]											**
 **********************************************************************/
@@ -65,6 +78,22 @@ public:
 	// Swap buffers
 	static void swapBuffers();
 
+	// Whether the GL context supports OpenGL major.minor. In headless mode this
+	// is the version of the GL recorder.
+	static bool isGLVersionSupported(const int major, const int minor);
+
+	// Instanced drawing (requires OpenGL 3.3)
+	static bool isInstancingSupported() { return s_instancingSupported; }
+
+	// Number of textures the default shader can sample in one draw
+	static uint getTextureSlotCount() { return s_textureSlotCount; }
+
+	// Asynchronous screenshots and frame sequences
+	static FrameCapture &getFrameCapture() { return *s_frameCapture; }
+
+	// Render targets shared by render graphs. Unused targets are deleted by swapBuffers().
+	static RenderTargetPool &getRenderTargetPool() { return *s_renderTargetPool; }
+
 protected:
 	static void init();
 	static void clear();
@@ -74,10 +103,25 @@ protected:
 	static ShaderPtr s_defaultShader;
 	static Texture2DPtr s_defaultTexture;
 	static GLuint s_vao;
-	static GLuint s_vbo;
-	static GLuint s_ibo;
+
+	// Ring buffers for vertices and indices drawn from client memory
+	static StreamBuffer *s_vertexStream;
+	static StreamBuffer *s_indexStream;
 	static int s_vsync;
 
+	static FrameCapture *s_frameCapture;
+	static RenderTargetPool *s_renderTargetPool;
+
+	// Texture slots
+	static uint s_textureSlotCount;
+
+	// Instanced sprites
+	static bool s_instancingSupported;
+	static ShaderPtr s_instancedSpriteShader;
+	static GLuint s_quadVbo;
+	static GLuint s_quadIbo;
+	static GLuint s_instanceVbo;
+
 	static GraphicsContext s_graphicsContext;
 };
 
@@ -8,6 +8,7 @@ BEGIN_XD_NAMESPACE
 class XDAPI BlendState
 {
 	friend class GraphicsContext;
+	friend class SoftwareRasterizer;
 public:
 
 	enum BlendFactor
@@ -0,0 +1,134 @@
+#ifndef X2D_DRAW_LIST_H
+#define X2D_DRAW_LIST_H
+
+#include "../engine.h"
+#include "graphicscontext.h"
+#include "vertex.h"
+
+BEGIN_XD_NAMESPACE
+
+/*********************************************************************
+**	Draw list														**
+**********************************************************************/
+// Records drawing commands into a linear buffer to be replayed later.
+// Drawing to the graphics context of a draw list, directly or through a
+// SpriteBatch, records the commands instead of calling GL, so lists can be
+// built on any thread. replay() has to be called on the GL thread.
+//
+// Textures and shaders are kept alive by the list. Render targets and
+// vertex/index buffers are referenced, and must outlive the list. Objects
+// that upload buffers when drawn (SpriteCache, TileMap) have to be
+// recorded on the GL thread.
+// The recording context starts in the default state, and replaying a list
+// applies the state changes it recorded to the target context.
+class XDAPI DrawList
+{
+	friend class GraphicsContext;
+	friend class SoftwareRasterizer;
+public:
+	// The viewport size commands are recorded for
+	DrawList(const uint width, const uint height);
+	~DrawList();
+
+	GraphicsContext &getGraphicsContext() { return *m_graphicsContext; }
+
+	// Removes all commands and resets the recording context
+	void clear();
+
+	// Executes the commands on graphicsContext
+	void replay(GraphicsContext &graphicsContext) const;
+
+	uint getCommandCount() const { return m_commandCount; }
+	uint getSizeInBytes() const { return m_data.size(); }
+
+private:
+	enum Command
+	{
+		CMD_ENABLE,
+		CMD_DISABLE,
+		CMD_CLEAR,
+		CMD_SET_RENDER_TARGET,
+		CMD_SWITCH_RENDER_TARGET,
+		CMD_RESIZE_VIEWPORT,
+		CMD_SET_MODEL_VIEW_MATRIX,
+		CMD_PUSH_MATRIX,
+		CMD_POP_MATRIX,
+		CMD_SET_TEXTURE,
+		CMD_SET_SHADER,
+		CMD_SET_BLEND_STATE,
+		CMD_DRAW_INDEXED_VERTICES,
+		CMD_DRAW_INDEXED_SPRITE_VERTICES,
+		CMD_DRAW_SPRITE_INSTANCES,
+		CMD_DRAW_INDEXED_BUFFERS,
+		CMD_DRAW_VERTICES,
+		CMD_DRAW_VERTEX_BUFFER,
+		CMD_DRAW_INDEXED_PACKED_VERTICES,
+		CMD_DRAW_PACKED_VERTICES
+	};
+
+	// Called by the recording context
+	void recordEnable(const GraphicsContext::Capability cap, const bool enable);
+	void recordClear(const uint mask, const Color &fillColor);
+	void recordSetRenderTarget(RenderTarget2D *renderTarget);
+	void recordSwitchRenderTarget(RenderTarget2D *renderTarget);
+	void recordResizeViewport(const uint w, const uint h);
+	void recordSetModelViewMatrix(const Matrix4 &mat);
+	void recordPushMatrix(const Matrix4 &mat);
+	void recordPopMatrix();
+	void recordSetTexture(const uint slot, const Texture2DPtr texture);
+	void recordSetShader(const ShaderPtr shader);
+	void recordSetBlendState(const BlendState &blendState);
+	void recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const Vertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount);
+	void recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const SpriteVertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount);
+	void recordDrawSpriteInstances(const SpriteInstance *instances, const uint instanceCount);
+	void recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const VertexBuffer *vbo, const IndexBuffer *ibo, const uint indexOffset, const uint indexCount);
+	void recordDrawPrimitives(const GraphicsContext::PrimitiveType type, const Vertex *vertices, const uint vertexCount);
+	void recordDrawPrimitives(const GraphicsContext::PrimitiveType type, const VertexBuffer *vbo);
+	void recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount, const uint *indices, const uint indexCount);
+	void recordDrawPrimitives(const GraphicsContext::PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount);
+
+	// Index of a null texture or shader
+	static const uint NULL_RESOURCE = 0xFFFFFFFF;
+
+	// Reads a value from the command buffer and advances the read pointer
+	template<typename T> static void read(const uchar *&data, T &value) { memcpy(&value, data, sizeof(T)); data += sizeof(T); }
+	template<typename T> static T read(const uchar *&data) { T value; read(data, value); return value; }
+
+	// Returns an array written by writeArray() and advances the read pointer past it
+	static const uchar *readArray(const uchar *&data, const uint size, const uint alignment);
+	template<typename T> static const T *readArray(const uchar *&data, const uint count) { return (const T*) readArray(data, count * sizeof(T), alignment_of<T>::value); }
+
+	// Reads a vertex format written by writeFormat()
+	static void readFormat(const uchar *&data, VertexFormat &fmt);
+
+	// Appends to the command buffer
+	void writeCommand(const Command command);
+	void write(const void *data, const uint size);
+	template<typename T> void write(const T &value) { write(&value, sizeof(T)); }
+
+	// Appends an array at an offset aligned for its elements, so replays can
+	// use it in place. The buffer storage is aligned for any element type.
+	void writeArray(const void *data, const uint size, const uint alignment);
+	template<typename T> void writeArray(const T *values, const uint count) { writeArray(values, count * sizeof(T), alignment_of<T>::value); }
+
+	// Appends the element count and data type of every attribute of fmt
+	void writeFormat(const VertexFormat &fmt);
+
+	// Command buffer
+	vector<uchar> m_data;
+	uint m_commandCount;
+
+	// Resources referenced by the commands
+	vector<Texture2DPtr> m_textures;
+	vector<ShaderPtr> m_shaders;
+	vector<Vertex> m_vertices;
+
+	// Recording context
+	uint m_width;
+	uint m_height;
+	GraphicsContext *m_graphicsContext;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_DRAW_LIST_H
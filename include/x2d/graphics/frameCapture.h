@@ -0,0 +1,106 @@
+#ifndef X2D_FRAME_CAPTURE_H
+#define X2D_FRAME_CAPTURE_H
+
+#include "../engine.h"
+
+BEGIN_XD_NAMESPACE
+
+class Texture2D;
+
+/*********************************************************************
+**	Frame capture													**
+**********************************************************************/
+// Saves screenshots, textures and frame sequences as png files without
+// stalling the frame. Pixels are read into pixel buffer objects, which are
+// mapped a frame or two later once the GPU has written them, and the images
+// are encoded and written to disk on a background thread.
+class XDAPI FrameCapture
+{
+	friend class Graphics;
+public:
+	// Saves the front buffer
+	void saveScreenshot(const string &path);
+
+	// Saves the first mip level of texture. Only byte textures can be saved.
+	void saveTexture(const Texture2D &texture, const string &path);
+
+	// Saves every frameInterval-th frame as path00000.png, path00001.png, ...
+	void startSequence(const string &path, const uint frameInterval = 1);
+	void stopSequence();
+	bool isRecordingSequence() const { return m_sequenceInterval > 0; }
+
+	// Blocks until every capture started so far is on disk
+	void finish();
+
+	// Number of captures not yet written to disk
+	uint getPendingCount() const;
+
+private:
+	FrameCapture();
+	~FrameCapture();
+
+	// Called by Graphics at the end of every frame, before the buffers are swapped
+	void update();
+
+	// A read in progress. The pixel buffer is mapped once the fence has signaled.
+	struct Readback
+	{
+		GLuint pixelBuffer;
+		uint size;
+		GLsync fence;
+		uint frame;
+		uint width;
+		uint height;
+		uint bitsPerPixel;
+		string path;
+	};
+
+	// An image waiting to be encoded and saved by the writer thread
+	struct Image
+	{
+		uchar *data;
+		uint width;
+		uint height;
+		uint bitsPerPixel;
+		string path;
+	};
+
+	// Binds a pixel buffer large enough for the image to GL_PIXEL_PACK_BUFFER
+	Readback beginReadback(const uint width, const uint height, const uint bitsPerPixel, const string &path);
+
+	// Unbinds the pixel buffer and queues the readback
+	void endReadback(Readback &readback);
+
+	// Reads the color buffer selected by buffer (GL_FRONT or GL_BACK)
+	void readFramebuffer(const GLenum buffer, const string &path);
+
+	// Moves a completed readback to the writer thread. Waits for the GPU if wait is set.
+	bool completeReadback(Readback &readback, const bool wait);
+
+	void writerMain();
+
+	// Readbacks in the order they were started, and pixel buffers to reuse
+	deque<Readback> m_readbacks;
+	vector<pair<GLuint, uint>> m_freePixelBuffers; // Id and size
+	bool m_useFences;
+	uint m_frame;
+
+	// Frame sequence
+	string m_sequencePath;
+	uint m_sequenceInterval;
+	uint m_sequenceFrame;
+	uint m_sequenceIndex;
+
+	// Writer thread
+	thread m_thread;
+	mutable mutex m_mutex;
+	condition_variable m_imageCondition;
+	condition_variable m_doneCondition;
+	queue<Image> m_images;
+	uint m_writingCount;
+	bool m_quit;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_FRAME_CAPTURE_H
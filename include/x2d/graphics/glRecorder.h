@@ -0,0 +1,96 @@
+#ifndef X2D_GL_RECORDER_H
+#define X2D_GL_RECORDER_H
+
+#include "../engine.h"
+
+BEGIN_XD_NAMESPACE
+
+/*********************************************************************
+**	GL recorder [static]											**
+**********************************************************************/
+// A headless stand-in for the OpenGL driver. install() points the gl3w
+// entry points used by the engine at functions that keep GL objects in
+// memory and count what was asked of them, so the rendering code runs
+// unchanged without a GPU or a window. Buffer contents are kept, so the
+// vertices and indices drawn can be inspected. Nothing is rasterized, and
+// reading pixels returns zeros.
+//
+// Games running with XD_HEADLESS use the recorder instead of a GL context.
+class XDAPI GLRecorder
+{
+public:
+	struct DrawCall
+	{
+		GLenum mode;
+		uint count;				// Vertices, or indices for indexed draws
+		uint instanceCount;
+		bool indexed;
+		GLuint program;
+		GLuint framebuffer;
+		GLuint texture;			// Bound to unit 0
+	};
+
+	struct Recording
+	{
+		Recording() :
+			glCalls(0),
+			vertexCount(0),
+			programChanges(0),
+			textureBinds(0),
+			bufferBinds(0),
+			vertexArrayBinds(0),
+			framebufferBinds(0),
+			blendFuncChanges(0),
+			capabilityChanges(0),
+			clears(0),
+			textureUploads(0),
+			textureUploadBytes(0),
+			bufferUploadBytes(0)
+		{
+		}
+
+		vector<DrawCall> drawCalls;
+		uint glCalls;					// Every call to a recorded entry point
+		uint vertexCount;				// Vertices or indices drawn, for every instance
+		uint programChanges;
+		uint textureBinds;
+		uint bufferBinds;
+		uint vertexArrayBinds;
+		uint framebufferBinds;
+		uint blendFuncChanges;
+		uint capabilityChanges;			// glEnable() and glDisable()
+		uint clears;
+		uint textureUploads;			// glTexImage2D() and glTexSubImage2D()
+		uint64_t textureUploadBytes;
+		uint64_t bufferUploadBytes;		// Buffer data, sub data and ranges mapped for writing
+	};
+
+	// Replaces the gl3w entry points. Objects created before are lost.
+	static void install();
+	static bool isInstalled() { return s_installed; }
+
+	// The OpenGL version the recorder implements. gl3wIsSupported() only knows
+	// the version of a real context, so use Graphics::isGLVersionSupported().
+	static const int MAJOR_VERSION = 3;
+	static const int MINOR_VERSION = 3;
+	static bool isSupported(const int major, const int minor) { return major < MAJOR_VERSION || (major == MAJOR_VERSION && minor <= MINOR_VERSION); }
+
+	static const Recording &getRecording();
+	static void clearRecording();
+
+	// Contents of a buffer, or nullptr if the buffer doesn't exist
+	static const vector<uchar> *getBufferData(const GLuint buffer);
+
+	// Size of the first level of a texture
+	static Vector2i getTextureSize(const GLuint texture);
+
+	// Buffers, textures, shaders, programs, vertex arrays and framebuffers not deleted
+	static uint getObjectCount();
+
+private:
+	static bool s_installed;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_GL_RECORDER_H
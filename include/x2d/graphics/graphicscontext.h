@@ -10,8 +10,13 @@ BEGIN_XD_NAMESPACE
 
 class RenderTarget2D;
 class Vertex;
+struct SpriteVertex;
+struct SpriteInstance;
 class VertexBuffer;
 class IndexBuffer;
+class StreamBuffer;
+class VertexFormat;
+class DrawList;
 
 /**
  * \brief Handles primitive rendering to the screen.
@@ -19,6 +24,15 @@ class IndexBuffer;
 class XDAPI GraphicsContext
 {
 	friend class Graphics;
+	friend class DrawList;
+	friend class Texture2D;
+	friend class VertexBuffer;
+	friend class DynamicVertexBuffer;
+	friend class IndexBuffer;
+	friend class DynamicIndexBuffer;
+	friend class StreamBuffer;
+	friend class FrameCapture;
+	friend class RenderTarget2D;
 public:
 
 	/**
@@ -88,6 +102,14 @@ public:
 	 */
 	void setRenderTarget(RenderTarget2D *renderTarget);
 
+	/**
+	 * Switches to \p renderTarget, keeping the model-view matrix stack. The
+	 * viewport and projection are only updated when the size changes, so
+	 * effects ping-ponging between targets of the same size only rebind.
+	 * \param renderTarget The target buffer to render to, or nullptr for the screen.
+	 */
+	void switchRenderTarget(RenderTarget2D *renderTarget);
+
 	/**
 	 * Get current render target.
 	 */
@@ -111,6 +133,8 @@ public:
 	/**
 	 * Pushes a matrix onto the model-view matrix stack.
 	 * The matrix is pushed as follows \code stack.push_back(stack.top() * mat) \endcode
+	 * The stack holds up to MAX_MATRIX_STACK_DEPTH matrices. Pushes beyond
+	 * that are dropped, along with the pops that match them.
 	 * \param mat Matrix to push on the stack.
 	 */
 	void pushMatrix(const Matrix4 &mat);
@@ -132,6 +156,26 @@ public:
 	 */
 	Texture2DPtr getTexture() const;
 
+	/**
+	 * Maximum number of texture slots. See Graphics::getTextureSlotCount()
+	 * for the number available.
+	 */
+	static const uint MAX_TEXTURE_SLOTS = 8;
+
+	/**
+	 * Set texture for a slot of the default shader. Primitives select a slot with
+	 * their texture slot attribute, so one draw can use several textures.
+	 * Slot 0 is the texture set by setTexture().
+	 * \param slot Texture slot to set.
+	 * \param texture Texture to apply to primitives using the slot.
+	 */
+	void setTexture(const uint slot, const Texture2DPtr texture);
+
+	/**
+	 * Gets the texture of a slot.
+	 */
+	Texture2DPtr getTexture(const uint slot) const;
+
 	/**
 	 * Set shader. Every vertex and fragment rendered after this will
 	 * have the effect of \p shader applied to them.
@@ -157,7 +201,9 @@ public:
 	BlendState getBlendState();
 
 	/**
-	 * Saves a screen shot of the back buffer to \p path as a PNG file.
+	 * Saves a screen shot to \p path as a PNG file. The file is written on a
+	 * background thread a frame or two later. Graphics::getFrameCapture().finish()
+	 * waits for it.
 	 * \param path Screen shot destination path
 	 */
 	void saveScreenshot(string path);
@@ -195,6 +241,29 @@ public:
 	 */
 	void drawIndexedPrimitives(const PrimitiveType type, const Vertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount);
 
+	/**
+	 * Renders an indexed primitive to the screen using packed sprite vertices.
+	 * The vertex array is uploaded directly without any conversion.
+	 * \param type Types of primitives to render.
+	 * \param vertices Array of sprite vertices to render.
+	 * \param vertexCount Number of vertices to render.
+	 * \param indices Array of indices.
+	 * \param indexCount Number of indices.
+	 */
+	void drawIndexedPrimitives(const PrimitiveType type, const SpriteVertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount);
+
+	/**
+	 * Renders an indexed primitive to the screen using vertices packed in fmt,
+	 * such as the vertices of a VertexLayout. The data is uploaded as it is.
+	 * \param type Types of primitives to render.
+	 * \param fmt Format of the vertex data.
+	 * \param vertices Packed vertex data.
+	 * \param vertexCount Number of vertices to render.
+	 * \param indices Array of indices.
+	 * \param indexCount Number of indices.
+	 */
+	void drawIndexedPrimitives(const PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount, const uint *indices, const uint indexCount);
+
 	/**
 	 * Renders an indexed primitive to the screen using vertex and index buffers.
 	 * \param type Types of primitives to render.
@@ -203,6 +272,26 @@ public:
 	 */
 	void drawIndexedPrimitives(const PrimitiveType type, const VertexBuffer *vbo, const IndexBuffer *ibo);
 
+	/**
+	 * Renders a range of an indexed primitive to the screen using vertex and index buffers.
+	 * \param type Types of primitives to render.
+	 * \param vbo Vertex buffer object.
+	 * \param ibo Index buffer object.
+	 * \param indexOffset First index to render.
+	 * \param indexCount Number of indices to render.
+	 */
+	void drawIndexedPrimitives(const PrimitiveType type, const VertexBuffer *vbo, const IndexBuffer *ibo, const uint indexOffset, const uint indexCount);
+
+	/**
+	 * Renders sprite instances as textured quads. Each instance is expanded
+	 * from a unit quad in the vertex shader. If a shader is set, it has to
+	 * take the same attributes as the default instanced shader.
+	 * Requires Graphics::isInstancingSupported().
+	 * \param instances Array of sprite instances to render.
+	 * \param instanceCount Number of instances to render.
+	 */
+	void drawSpriteInstances(const SpriteInstance *instances, const uint instanceCount);
+
 	/**
 	 * Renders primitives to the screen.
 	 * \param type Types of primitives to render.
@@ -211,6 +300,15 @@ public:
 	 */
 	void drawPrimitives(const PrimitiveType type, const Vertex *vertices, const uint vertexCount);
 
+	/**
+	 * Renders primitives to the screen using vertices packed in fmt.
+	 * \param type Types of primitives to render.
+	 * \param fmt Format of the vertex data.
+	 * \param vertices Packed vertex data.
+	 * \param vertexCount Number of vertices to render.
+	 */
+	void drawPrimitives(const PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount);
+
 	/**
 	 * Renders primitives to the screen.
 	 * \param type Types of primitives to render.
@@ -266,18 +364,139 @@ public:
 	 */
 	void drawCircle(const float x, const float y, const float radius, const uint segments, const Color &color = Color(255));
 
+	/**
+	 * Rendering counters. State changes are counted when a draw call uses
+	 * a different shader, blend state or texture than the draw call before it.
+	 */
+	struct Stats
+	{
+		Stats() :
+			drawCalls(0),
+			glCalls(0),
+			textureChanges(0),
+			shaderChanges(0),
+			blendStateChanges(0),
+			vertexBytes(0),
+			indexBytes(0)
+		{
+		}
+
+		uint drawCalls;				///< Number of draw calls
+		uint glCalls;				///< Number of GL calls made by the context and its state cache
+		uint textureChanges;		///< Number of texture slot changes between draw calls
+		uint shaderChanges;			///< Number of shader changes between draw calls
+		uint blendStateChanges;		///< Number of blend state changes between draw calls
+		uint64_t vertexBytes;		///< Bytes of vertex and instance data uploaded
+		uint64_t indexBytes;		///< Bytes of index data uploaded
+	};
+
+	/**
+	 * Returns the counters of the frame being rendered.
+	 */
+	Stats getStats() const;
+
+	/**
+	 * Returns the counters of the last completed frame.
+	 */
+	const Stats &getFrameStats() const
+	{
+		return m_frameStats;
+	}
+
 private:
-	GraphicsContext();
+	GraphicsContext(DrawList *drawList = nullptr);
+	void setProjection(const uint w, const uint h);
+	void updateProjection(const uint w, const uint h); // Keeps the model-view matrix stack
 	void setupContext();
+	void setupContext(const ShaderPtr defaultShader);
+	void endFrame();
+
+	// Shadow of the GL state, so that setting unchanged state makes no GL calls.
+	// Everything binding programs, textures or buffers has to go through these
+	// for the shadow to stay in sync with GL.
+	static const uint MAX_TEXTURE_UNITS = 32;
+	struct VertexArray
+	{
+		GLuint id;
+		GLuint elementArrayBuffer; // Part of the vertex array state
+	};
+	struct GLState
+	{
+		GLuint program;
+		GLenum blendFunc[4];
+		uint activeTextureUnit;
+		GLuint textures[MAX_TEXTURE_UNITS];
+		GLuint arrayBuffer;
+		VertexArray *vertexArray;
+		GLuint framebuffer;
+		uint viewportWidth;
+		uint viewportHeight;
+	};
+	static GLState s_glState;
+	static uint s_glCallCount;
+
+	// Vertex array objects keyed by vertex format hash (high bits) and vertex
+	// buffer (low bits), so drawing a layout that has been seen before only binds
+	// its vertex array. The default vertex array is bound when nothing has been drawn.
+	static const uint SPRITE_INSTANCE_FORMAT_HASH = 0xFFFFFFFF;
+	static VertexArray s_defaultVertexArray;
+	static unordered_map<uint64_t, VertexArray> s_vertexArrays;
+
+	static void useProgram(const GLuint program);
+	static void setBlendFunc(const BlendState &blendState);
+	static void bindTexture(const uint unit, const GLuint texture);
+	static void bindTexture(const GLuint texture); // On the active unit
+	static void bindBuffer(const GLenum target, const GLuint buffer);
+	static void bindVertexArray(VertexArray *vertexArray);
+	static void bindFramebuffer(const GLuint framebuffer);
+	static void setViewport(const uint w, const uint h);
+
+	// Binds the vertex array for the key, and returns true if it was just
+	// created and still needs its attributes set up
+	static bool bindVertexArray(const uint formatHash, const GLuint buffer);
+
+	// Binds the vertex array of a vertex format stored in buffer
+	static void bindVertexFormat(const VertexFormat &fmt, const GLuint buffer);
+
+	// Write into the stream buffers, and return the first vertex and the byte offset of the indices
+	uint streamVertices(const Vertex *vertices, const uint vertexCount, const uint vertexSizeInBytes);
+	uint streamVertices(const void *vertices, const uint vertexCount, const uint vertexSizeInBytes);
+	uint streamIndices(const uint *indices, const uint indexCount, const uint baseVertex);
+
+	// Called before deleting GL objects, as their ids can be reused. Releasing a
+	// vertex buffer deletes the vertex arrays using it.
+	static void releaseTexture(const GLuint texture);
+	static void releaseBuffer(const GLuint buffer);
+	static void releaseFramebuffer(const GLuint framebuffer);
 
 	uint m_width;
 	uint m_height;
-	Texture2DPtr m_texture;
+	Texture2DPtr m_textures[MAX_TEXTURE_SLOTS];
 	ShaderPtr m_shader;
 	BlendState m_blendState;
 	RenderTarget2D *m_renderTarget;
-	stack<Matrix4> m_modelViewMatrixStack;
+
+	// Model-view matrix stack. Entry 0 is the identity, below the matrices set or pushed.
+	static const uint MAX_MATRIX_STACK_DEPTH = 32;
+	Matrix4 m_modelViewMatrixStack[MAX_MATRIX_STACK_DEPTH + 1];
+	uint m_modelViewMatrixDepth;
+	uint m_modelViewMatrixOverflow; // Dropped pushes still to be popped
 	Matrix4 m_projectionMatrix;
+
+	// Projection times model-view, recomputed by the first draw after either changes
+	Matrix4 m_modelViewProjectionMatrix;
+	bool m_modelViewProjectionDirty;
+
+	// Draw list recording the commands, if this is a recording context
+	DrawList *m_drawList;
+
+	// Counters, and the state used by the last draw call to detect changes
+	Stats m_stats;
+	Stats m_frameStats;
+	uint m_frameGlCallStart;
+	const Shader *m_drawShader;
+	BlendState m_drawBlendState;
+	const Texture2D *m_drawTextures[MAX_TEXTURE_SLOTS];
 };
 
 END_XD_NAMESPACE
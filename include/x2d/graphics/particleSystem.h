@@ -0,0 +1,110 @@
+#ifndef X2D_PARTICLE_SYSTEM_H
+#define X2D_PARTICLE_SYSTEM_H
+
+#include "../engine.h"
+#include "texture.h"
+#include "textureregion.h"
+
+BEGIN_XD_NAMESPACE
+
+struct SpriteVertex;
+
+/*********************************************************************
+**	Particle emitter												**
+**********************************************************************/
+// Spawns particles at a point with a random speed, direction and lifetime
+struct XDAPI ParticleEmitter
+{
+	ParticleEmitter() :
+		position(0.0f),
+		rate(0.0f),
+		minSpeed(0.0f),
+		maxSpeed(0.0f),
+		direction(0.0f),
+		spread(360.0f),
+		minLife(1.0f),
+		maxLife(1.0f)
+	{
+	}
+
+	Vector2 position;
+	float rate;					// Particles per second
+	float minSpeed, maxSpeed;	// Pixels per second
+	float direction;			// Degrees
+	float spread;				// Degrees, centered on the direction
+	float minLife, maxLife;		// Seconds
+};
+
+/*********************************************************************
+**	Particle system													**
+**********************************************************************/
+// A fixed pool of particles sharing one texture, stored as one array per
+// component. Particles are integrated in bulk and drawn through
+// SpriteBatch::drawParticles(), which writes their quads straight into
+// the batch vertex stream.
+class XDAPI ParticleSystem
+{
+	friend class SpriteBatch;
+public:
+	ParticleSystem(const uint capacity);
+
+	// Emitters spawn particles every update
+	uint addEmitter(const ParticleEmitter &emitter);
+	ParticleEmitter &getEmitter(const uint id);
+	uint getEmitterCount() const { return m_emitters.size(); }
+	void removeEmitters();
+
+	// Spawns count particles at once. Particles beyond the capacity are dropped.
+	void emit(const ParticleEmitter &emitter, const uint count);
+
+	// Spawns particles and advances the live ones by dt seconds
+	void update(const float dt);
+
+	void clear();
+
+	// Appearance, interpolated over the lifetime of each particle
+	void setTexture(const Texture2DPtr texture);
+	Texture2DPtr getTexture() const { return m_texture; }
+	void setTextureRegion(const TextureRegion &textureRegion);
+	TextureRegion getTextureRegion() const { return m_textureRegion; }
+	void setColor(const Color &startColor, const Color &endColor);
+	void setSize(const float startSize, const float endSize);
+
+	// Acceleration applied to every particle, in pixels per second squared
+	void setGravity(const Vector2 &gravity);
+	Vector2 getGravity() const { return Vector2(m_gravityX, m_gravityY); }
+
+	Random &getRandom() { return m_random; }
+
+	uint getParticleCount() const { return m_count; }
+	uint getCapacity() const { return m_capacity; }
+
+private:
+	// Writes 4 vertices and 6 indices per particle
+	void getVertices(SpriteVertex *vertices, uint *indices, const uint indexOffset, const uint textureSlot) const;
+
+	// Particle components. Life goes from 0 to 1 at lifeRate per second.
+	vector<float> m_positionX;
+	vector<float> m_positionY;
+	vector<float> m_velocityX;
+	vector<float> m_velocityY;
+	vector<float> m_life;
+	vector<float> m_lifeRate;
+	uint m_count;
+	uint m_capacity;
+
+	// Emitters and their fractional spawn counts
+	vector<ParticleEmitter> m_emitters;
+	vector<float> m_emitterAccumulators;
+	Random m_random;
+
+	Texture2DPtr m_texture;
+	TextureRegion m_textureRegion;
+	Color m_startColor, m_endColor;
+	float m_startSize, m_endSize;
+	float m_gravityX, m_gravityY;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_PARTICLE_SYSTEM_H
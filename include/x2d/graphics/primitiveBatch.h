@@ -0,0 +1,91 @@
+#ifndef X2D_PRIMITIVE_BATCH_H
+#define X2D_PRIMITIVE_BATCH_H
+
+#include "../engine.h"
+#include "vertex.h"
+#include "blendState.h"
+#include "texture.h"
+#include "shader.h"
+
+BEGIN_XD_NAMESPACE
+
+class GraphicsContext;
+
+/*********************************************************************
+**	Primitive batch													**
+**********************************************************************/
+// Collects untextured rectangles, circles and lines into one triangle list,
+// drawn with a single draw call when the batch ends. Lines are drawn as quads,
+// so filled and outlined shapes share the same stream. Primitives are drawn
+// with the shader and model-view matrix the graphics context had when they
+// were added. Changing either between begin() and end() flushes the batch
+// at the next draw.
+class XDAPI PrimitiveBatch
+{
+public:
+	PrimitiveBatch(GraphicsContext &graphicsContext);
+
+	void begin(const BlendState &blendState = BlendState::PRESET_ALPHA_BLEND);
+	void end();
+
+	// Draws the primitives added since the last flush
+	void flush();
+
+	void drawRectangle(const Rect &rect, const Color &color);
+	void drawRectangleOutline(const Rect &rect, const Color &color, const float thickness = 1.0f);
+	void drawCircle(const Vector2 &center, const float radius, const uint segments, const Color &color);
+	void drawCircleOutline(const Vector2 &center, const float radius, const uint segments, const Color &color, const float thickness = 1.0f);
+	void drawLine(const Vector2 &p0, const Vector2 &p1, const Color &color, const float thickness = 1.0f);
+
+	// Draws a line between each pair of consecutive points, and between the
+	// last and the first if closed is set. Joints aren't mitered.
+	void drawPolyline(const Vector2 *points, const uint pointCount, const Color &color, const float thickness = 1.0f, const bool closed = false);
+
+	GraphicsContext &getGraphicsContext() const { return m_graphicsContext; }
+
+	// Number of primitives drawn by the last end(), the draw calls used, and
+	// the flushes caused by state changes
+	uint getPrimitiveCount() const { return m_primitiveCount; }
+	uint getDrawCallCount() const { return m_drawCallCount; }
+	uint getAutoFlushCount() const { return m_autoFlushCount; }
+
+private:
+	// Flushes the batch if the shader or model-view matrix of the context
+	// changed since the pending primitives were added
+	void checkState();
+
+	// Add geometry without checking that the batch has begun
+	void addLine(const Vector2 &p0, const Vector2 &p1, const uint color, const float thickness);
+	void addQuad(const Vector2 &p0, const Vector2 &p1, const Vector2 &p2, const Vector2 &p3, const uint color); // Corners in order
+	void addVertex(const float x, const float y, const uint color);
+
+	// Returns the cosine and sine of the angles of a circle with segments
+	// vertices. The tables are kept, as the same segment counts are reused.
+	const vector<Vector2> &getCircleTable(const uint segments);
+
+	static uint toVertexColor(const Color &color);
+
+	GraphicsContext &m_graphicsContext;
+
+	// Set between begin() and end(), with the context state to restore
+	bool m_beingCalled;
+	BlendState m_blendState;
+	BlendState m_prevBlendState;
+	Texture2DPtr m_prevTexture;
+
+	// Context state of the pending primitives
+	ShaderPtr m_shader;
+	Matrix4 m_modelViewMatrix;
+
+	vector<SpriteVertex> m_vertices;
+	vector<uint> m_indices;
+	unordered_map<uint, vector<Vector2>> m_circleTables;
+
+	uint m_primitiveCount;
+	uint m_drawCallCount;
+	uint m_autoFlushCount;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_PRIMITIVE_BATCH_H
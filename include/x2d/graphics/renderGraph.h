@@ -0,0 +1,128 @@
+#ifndef X2D_RENDER_GRAPH_H
+#define X2D_RENDER_GRAPH_H
+
+#include "../engine.h"
+#include "pixmap.h"
+#include "texture.h"
+
+BEGIN_XD_NAMESPACE
+
+class RenderTarget2D;
+class GraphicsContext;
+
+/*********************************************************************
+**	Render target pool												**
+**********************************************************************/
+// Keeps render targets alive between uses so effects don't create and
+// destroy framebuffers and textures every frame. Targets are matched on
+// size, attachment count and pixel format. The contents of an acquired
+// target are undefined. Graphics::getRenderTargetPool() is trimmed every
+// frame. Other pools have to call endFrame() once per frame themselves.
+class XDAPI RenderTargetPool
+{
+public:
+	RenderTargetPool();
+	~RenderTargetPool();
+
+	RenderTarget2D *acquire(const uint width, const uint height, const uint targetCount = 1, const PixelFormat &fmt = PixelFormat());
+	void release(RenderTarget2D *renderTarget);
+
+	// Deletes the targets not acquired during the last frameCount calls to endFrame()
+	void endFrame(const uint frameCount = 60);
+
+	// Deletes all targets. None may be acquired.
+	void clear();
+
+	uint getTargetCount() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		RenderTarget2D *renderTarget;
+		uint width;
+		uint height;
+		uint targetCount;
+		PixelFormat format;
+		bool acquired;
+		uint unusedFrames;
+	};
+
+	vector<Entry> m_entries;
+};
+
+/*********************************************************************
+**	Render graph													**
+**********************************************************************/
+// Runs render passes that declare the targets they read and write. Transient
+// targets are taken from a RenderTargetPool right before the first pass
+// writing them and handed back after the last pass reading them, so
+// targets with the same description and disjoint lifetimes share one
+// render target. Passes whose output is never used are skipped, and the
+// render target of the graphics context only changes between passes
+// writing different targets.
+//
+// Passes run in the order they were added. A graph can be executed again
+// every frame, or cleared and rebuilt.
+class XDAPI RenderGraph
+{
+public:
+	typedef function<void(GraphicsContext&, const RenderGraph&)> PassFunc;
+
+	RenderGraph(RenderTargetPool &pool);
+
+	// A target allocated from the pool while the graph executes
+	uint createTarget(const uint width, const uint height, const uint targetCount = 1, const PixelFormat &fmt = PixelFormat());
+
+	// A target owned by the caller. Nullptr is the back buffer. Passes
+	// writing imported targets are never skipped.
+	uint importTarget(RenderTarget2D *renderTarget);
+
+	// Adds a pass drawing to output. Returns the pass index.
+	uint addPass(const string &name, const uint output, const PassFunc &func);
+	void addInput(const uint pass, const uint input);
+
+	// Runs the passes on graphicsContext, and restores its render target
+	void execute(GraphicsContext &graphicsContext);
+
+	// The render target and textures of a resource, while the graph executes
+	RenderTarget2D *getTarget(const uint resource) const;
+	Texture2DPtr getTexture(const uint resource, const uint target = 0) const;
+
+	void clear();
+
+	uint getPassCount() const { return m_passes.size(); }
+
+	// Passes run by the last execute(), and render target switches they caused
+	uint getExecutedPassCount() const { return m_executedPassCount; }
+	uint getTargetSwitchCount() const { return m_targetSwitchCount; }
+
+private:
+	struct Resource
+	{
+		RenderTarget2D *renderTarget;
+		bool imported;
+		uint width;
+		uint height;
+		uint targetCount;
+		PixelFormat format;
+	};
+
+	struct Pass
+	{
+		string name;
+		uint output;
+		vector<uint> inputs;
+		PassFunc func;
+	};
+
+	RenderTargetPool &m_pool;
+	vector<Resource> m_resources;
+	vector<Pass> m_passes;
+
+	uint m_executedPassCount;
+	uint m_targetSwitchCount;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_RENDER_GRAPH_H
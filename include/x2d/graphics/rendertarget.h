@@ -19,8 +19,12 @@ public:
 
 	uint getWidth() const { return m_width; }
 	uint getHeight() const { return m_height; }
+	uint getTargetCount() const { return m_textureCount; }
 
 private:
+	// Attaches the textures once, at construction
+	void attachTextures();
+
 	void bind();
 	void unbind();
 
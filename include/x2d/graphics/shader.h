@@ -51,7 +51,8 @@ private:
 			type(0),
 			loc(0),
 			count(0),
-			data(0)
+			data(0),
+			dirty(true)
 		{
 		}
 
@@ -64,6 +65,7 @@ private:
 		int loc;
 		int count;
 		void *data;
+		bool dirty; // Changed since last uploaded
 	};
 
 	GLuint m_id, m_vertShaderID, m_fragShaderID;
@@ -0,0 +1,127 @@
+#ifndef X2D_SOFTWARE_RASTERIZER_H
+#define X2D_SOFTWARE_RASTERIZER_H
+
+#include "../engine.h"
+#include "blendState.h"
+#include "graphicscontext.h"
+#include "pixmap.h"
+#include "texture.h"
+
+BEGIN_XD_NAMESPACE
+
+class DrawList;
+class RenderTarget2D;
+struct SpriteVertex;
+
+/*********************************************************************
+**	Software rasterizer												**
+**********************************************************************/
+// Renders draw lists on the CPU, for reference images, thumbnails and
+// replays where no GPU is available. The subset of the graphics context
+// used by the engine is supported: textured and vertex colored triangles
+// drawn with the default shader, blend states, the scissor test and render
+// targets. Custom shaders are ignored, textures are sampled with the
+// nearest texel, and points, lines and vertex/index buffer draws are skipped.
+//
+// Triangles are collected until the render target changes or the list ends,
+// binned into tiles, and the tiles are filled in parallel on the engine's
+// worker pool. Pixels are kept as RGBA bytes in GL row order, with the
+// bottom row first.
+class XDAPI SoftwareRasterizer
+{
+public:
+	SoftwareRasterizer(const uint width, const uint height);
+
+	// Executes the commands of drawList. The screen and render targets keep
+	// their contents between calls, like they do on the GPU.
+	void render(const DrawList &drawList);
+
+	// The screen, or the first attachment of a render target drawn to
+	Pixmap getPixmap() const;
+	Pixmap getPixmap(RenderTarget2D *renderTarget) const;
+
+	// Scissor rectangle used while SCISSOR_TEST is enabled, with the origin
+	// at the top-left of the render target. Covers everything by default.
+	void setScissor(const Recti &rect);
+
+	// Pixels to sample for texture. Textures without pixels are read back
+	// from GL the first time they are drawn, which needs the GL thread.
+	void setTexturePixmap(const Texture2D *texture, const Pixmap &pixmap);
+	void clearTextures();
+
+	// Forgets the contents of every render target
+	void clearRenderTargets();
+
+	uint getWidth() const { return m_screen.width; }
+	uint getHeight() const { return m_screen.height; }
+
+	// Triangles filled by the last render()
+	uint getTriangleCount() const { return m_triangleCount; }
+
+	static const uint TILE_SIZE = 64;
+
+private:
+	struct Surface
+	{
+		Surface() : width(0), height(0), texture(nullptr) { }
+
+		uint width;
+		uint height;
+		vector<uint> pixels;		// RGBA bytes in memory order
+		const Texture2D *texture;	// Texture of a render target surface
+	};
+
+	// A triangle in screen space with the state it is drawn with
+	struct Triangle
+	{
+		float x[3], y[3];
+		float u[3], v[3];
+		float color[3][4];
+		const Surface *texture;
+		bool blend;
+		BlendState::BlendFactor blendFactors[4]; // Color src/dst, alpha src/dst
+		int clipRect[4]; // Left, top, right, bottom (exclusive)
+	};
+
+	// Adds the triangles of a primitive list
+	void addSpriteVertices(const GraphicsContext::PrimitiveType type, const SpriteVertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount);
+	void addTriangle(const SpriteVertex &v0, const SpriteVertex &v1, const SpriteVertex &v2);
+
+	// Fills the collected triangles into the current surface
+	void flush();
+	void fillTriangle(const Triangle &triangle, const int left, const int top, const int right, const int bottom);
+
+	void setRenderTarget(RenderTarget2D *renderTarget);
+	void clearSurface(const Color &color);
+	void getClipRect(int *rect) const;
+
+	const Surface *getTextureSurface(const Texture2DPtr &texture);
+	static void copyPixmap(const Pixmap &pixmap, Surface &surface);
+
+	Surface m_screen;
+	map<RenderTarget2D*, Surface> m_targetSurfaces;
+	map<const Texture2D*, Surface> m_textureSurfaces;
+	Surface m_whiteTexture;
+
+	// Draw state
+	Surface *m_surface;
+	uint m_viewportWidth, m_viewportHeight;
+	uint m_projectionWidth, m_projectionHeight;
+	vector<Matrix4> m_matrixStack;
+	Texture2DPtr m_textures[GraphicsContext::MAX_TEXTURE_SLOTS];
+	const Surface *m_drawTextures[GraphicsContext::MAX_TEXTURE_SLOTS]; // Resolved by the current draw
+	BlendState m_blendState;
+	bool m_blend;
+	bool m_scissorTest;
+	Recti m_scissor;
+
+	// Triangles waiting for flush(), and the triangles overlapping each tile
+	vector<Triangle> m_triangles;
+	vector<vector<uint>> m_bins;
+
+	uint m_triangleCount;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_SOFTWARE_RASTERIZER_H
@@ -9,9 +9,29 @@ BEGIN_XD_NAMESPACE
 class Texture2D;
 class Shape;
 
+// Sprite transforms as a structure of arrays, for transforming many sprites at once
+struct SpriteTransformArrays
+{
+	const float *positionX, *positionY;
+	const float *sizeX, *sizeY;
+	const float *originX, *originY;
+	const float *scaleX, *scaleY;
+	const float *angle; // In degrees
+};
+
+// Transforms count sprites into quad corners in QUAD_VERTICES order. Writes 8 floats
+// (four x, y pairs) per sprite to corners. Uses AVX2 or SSE2 when compiled with them.
+XDAPI void transformSpriteQuads(const SpriteTransformArrays &sprites, const uint count, float *corners);
+
+// Tests the bounds of count sprites (as given by Sprite::getAABB()) against a rectangle.
+// Writes 1 to visible for sprites that overlap it and 0 for the rest, and returns the
+// number of visible sprites. Uses SSE2 when compiled with it.
+XDAPI uint cullSpriteQuads(const SpriteTransformArrays &sprites, const uint count, const Rect &rect, uchar *visible);
+
 class XDAPI Sprite
 {
 	friend class SpriteBatch;
+	friend class SpriteCache;
 public:
 	Sprite(const Texture2DPtr texture = nullptr, const Rect &rectangle = Rect(0, 0, 0, 0), const Vector2 &origin = Vector2(0.0f, 0.0f), const float angle = 0.0f, const TextureRegion &region = TextureRegion(), const Color &color = Color(255), const float depth = 0.0f, const Vector2 scale = Vector2(1.0f, 1.0f));
 	//Sprite(const Texture2DPtr texture, const Rect &rectangle, const TextureRegion &region = TextureRegion(), const Color &color = Color(255), const float depth = 0.0f);
@@ -75,7 +95,16 @@ private:
 	Color m_color;
 
 	// Returns the transformed vertices
-	void getVertices(Vertex *vertices, uint *indices, const uint indexOffset = 0) const;
+	void getVertices(SpriteVertex *vertices, uint *indices, const uint indexOffset = 0) const;
+
+	// Writes the transform components stride floats apart, in SpriteTransformArrays order
+	void getTransform(float *transform, const uint stride) const;
+
+	// Returns the sprite as an instance for instanced drawing
+	void getInstance(SpriteInstance *instance) const;
+
+	// Returns the vertices given corners from transformSpriteQuads()
+	void getVertices(const float *corners, SpriteVertex *vertices, uint *indices, const uint indexOffset, const uint textureSlot = 0) const;
 };
 
 END_XD_NAMESPACE
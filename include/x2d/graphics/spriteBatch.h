@@ -12,6 +12,7 @@
 BEGIN_XD_NAMESPACE
 
 class Sprite;
+class ParticleSystem;
 
 /*********************************************************************
 **	Batch															**
@@ -19,7 +20,7 @@ class Sprite;
 class XDAPI SpriteBatch
 {
 public:
-	SpriteBatch(GraphicsContext &graphicsContext);
+	SpriteBatch(GraphicsContext &graphicsContext, const uint capacity = 256);
 	~SpriteBatch();
 
 	enum SpriteSortMode
@@ -33,11 +34,13 @@ public:
 
 	struct State
 	{
-		State(const SpriteSortMode mode = DEFERRED, const BlendState blendState = BlendState::PRESET_ALPHA_BLEND, const Matrix4 &projectionMatrix = Matrix4(), const ShaderPtr shader = nullptr) :
+		State(const SpriteSortMode mode = DEFERRED, const BlendState blendState = BlendState::PRESET_ALPHA_BLEND, const Matrix4 &projectionMatrix = Matrix4(), const ShaderPtr shader = nullptr, const bool instanced = false, const bool cull = false) :
 			mode(mode),
 			blendState(blendState),
 			projectionMatix(projectionMatrix),
-			shader(shader)
+			shader(shader),
+			instanced(instanced),
+			cull(cull)
 		{
 		}
 
@@ -45,17 +48,78 @@ public:
 		BlendState blendState;
 		Matrix4 projectionMatix;
 		ShaderPtr shader;
+
+		// Draw sprites as instances of a unit quad, expanded in the vertex shader.
+		// Falls back to regular vertices when instancing isn't supported.
+		bool instanced;
+
+		// Skip sprites outside the viewport. Not applied in IMMEDIATE mode.
+		bool cull;
 	};
 
 	void begin(const State &state = State());
 	void drawSprite(const Sprite &sprite);
 	void drawText(const Vector2 &pos, const string &text, const FontPtr font);
+
+	// Particles are drawn on top of the sprites of the batch, grouped by texture.
+	// The particle system must stay alive and unchanged until end().
+	void drawParticles(const ParticleSystem &particles);
 	void end();
 	void flush();
 
 	State getState() const { return m_state; }
 	GraphicsContext &getGraphicsContext() const { return m_graphicsContext; }
-	uint getTextureSwapCount() const;
+	uint getTextureSwapCount() const; // Number of draw calls end() will issue
+
+	// Storage grows geometrically up to the max capacity. When a batch is full
+	// at max capacity it is flushed automatically.
+	uint getCapacity() const { return m_capacity; }
+	void setMaxCapacity(const uint maxCapacity);
+	uint getMaxCapacity() const { return m_maxCapacity; }
+
+	// Usage stats for sizing batches
+	uint getPeakSpriteCount() const { return m_peakSpriteCount; }
+	uint getAutoFlushCount() const { return m_autoFlushCount; }
+	uint getCulledSpriteCount() const { return m_culledSpriteCount; }
+	void resetUsageStats();
+
+	// Counters recorded by every end(). Draw calls, state changes and uploads are
+	// the ones the graphics context saw between begin() and end(). Times are in seconds.
+	struct Stats
+	{
+		Stats() :
+			spriteCount(0),
+			culledSpriteCount(0),
+			particleCount(0),
+			drawCalls(0),
+			glCalls(0),
+			textureChanges(0),
+			shaderChanges(0),
+			blendStateChanges(0),
+			vertexBytes(0),
+			indexBytes(0),
+			sortTime(0.0),
+			vertexTime(0.0),
+			submitTime(0.0)
+		{
+		}
+
+		uint spriteCount;
+		uint culledSpriteCount;
+		uint particleCount;
+		uint drawCalls;
+		uint glCalls;
+		uint textureChanges;
+		uint shaderChanges;
+		uint blendStateChanges;
+		uint64_t vertexBytes;
+		uint64_t indexBytes;
+		double sortTime;
+		double vertexTime;
+		double submitTime;
+	};
+
+	const Stats &getStats() const { return m_stats; }
 
 private:
 
@@ -67,11 +131,74 @@ private:
 	bool m_beingCalled;
 
 	// Vertex & index buffers
-	Vertex *m_vertices;
+	SpriteVertex *m_vertices;
 	uint *m_indices;
 	Sprite *m_sprites;
 	uint m_spriteCount;
 
+	// Storage capacity (in sprites)
+	uint m_capacity;
+	uint m_maxCapacity;
+	void setCapacity(const uint capacity);
+
+	// Usage stats
+	uint m_peakSpriteCount;
+	uint m_autoFlushCount;
+	uint m_culledSpriteCount;
+
+	// Stats of the last batch, and the context counters when it began
+	Stats m_stats;
+	GraphicsContext::Stats m_contextStats;
+	Timer m_timer;
+
+	// Sort keys and scratch memory, kept between batches
+	mutable vector<uint64_t> m_sortKeys;
+	mutable vector<uint64_t> m_sortScratch;
+	mutable unordered_map<const Texture2D*, uint> m_textureSlots;
+
+	// Sprite bounds per texture batch in TEXTURE mode
+	struct TextureBatch
+	{
+		const Texture2D *texture;
+		Vector2 boundsMin;
+		Vector2 boundsMax;
+	};
+	mutable vector<TextureBatch> m_textureBatches;
+
+	// Returns the sprite sort keys in the order given by the sort mode
+	const uint64_t *sortSprites() const;
+
+	// Sprite transforms and quad corners, kept between batches
+	vector<float> m_transformData;
+
+	// Draw calls in sorted order. Each run has up to Graphics::getTextureSlotCount()
+	// textures, and each sprite refers to one of them by slot. Starts end with a sentinel.
+	mutable vector<uint> m_runStarts;
+	mutable vector<uint> m_runTextureStarts;
+	mutable vector<Texture2DPtr> m_runTextures;
+	mutable vector<uchar> m_spriteTextureSlots;
+	void findDrawRuns(const uint64_t *sortKeys) const;
+
+	// Removes sprites outside the viewport
+	vector<uchar> m_spriteVisibility;
+	void cullSprites();
+
+	// Instance buffer for instanced batches
+	vector<SpriteInstance> m_instances;
+
+	// Writes vertices and indices (or instances) for sorted sprites [begin, end). Safe to call
+	// from several threads at once with disjoint ranges.
+	void generateVertices(const uint64_t *sortKeys, const uint begin, const uint end);
+
+	// Particle systems drawn at end(), and their quads
+	vector<const ParticleSystem*> m_particleSystems;
+	vector<SpriteVertex> m_particleVertices;
+	vector<uint> m_particleIndices;
+	void drawParticleSystems();
+
+	// Applies the batch state to the graphics context
+	void applyState();
+
 	// Graphics context
 	GraphicsContext &m_graphicsContext;
 };
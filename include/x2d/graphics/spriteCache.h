@@ -0,0 +1,73 @@
+#ifndef X2D_SPRITE_CACHE_H
+#define X2D_SPRITE_CACHE_H
+
+#include "../engine.h"
+#include "texture.h"
+#include "sprite.h"
+#include "vertexbuffer.h"
+
+BEGIN_XD_NAMESPACE
+
+class GraphicsContext;
+
+/*********************************************************************
+**	Sprite cache													**
+**********************************************************************/
+// Holds sprites that rarely change, baked into vertex and index buffers.
+// Sprites are ordered by depth and grouped by texture, so drawing the
+// cache costs one draw call per texture group and no vertex work.
+class XDAPI SpriteCache
+{
+public:
+	SpriteCache();
+	~SpriteCache();
+
+	// Adds a sprite and returns its id
+	uint add(const Sprite &sprite);
+
+	// Replaces a sprite. If its texture and depth are unchanged, only its
+	// vertices are patched. Otherwise the buffers are rebuilt.
+	void set(const uint id, const Sprite &sprite);
+	const Sprite &get(const uint id) const;
+
+	void clear();
+
+	uint getSpriteCount() const { return m_sprites.size(); }
+	uint getDrawCallCount() const { return m_groups.size(); }
+
+	// Uploads any changes and draws the sprites using the current graphics context state
+	void draw(GraphicsContext &graphicsContext);
+
+private:
+	void rebuild();
+	void patch();
+
+	// Sprites by id
+	vector<Sprite> m_sprites;
+
+	// Buffer slot per sprite id and sprite id per buffer slot
+	vector<uint> m_spriteSlots;
+	vector<uint> m_slotSprites;
+
+	// Range of buffer slots sharing a texture
+	struct TextureGroup
+	{
+		Texture2DPtr texture;
+		uint start;
+		uint count;
+	};
+	vector<TextureGroup> m_groups;
+
+	// Baked buffers
+	DynamicVertexBuffer *m_vertexBuffer;
+	StaticIndexBuffer *m_indexBuffer;
+
+	// Pending changes
+	bool m_rebuild;
+	uint m_dirtyBegin;
+	uint m_dirtyEnd;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_SPRITE_CACHE_H
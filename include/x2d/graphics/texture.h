@@ -14,6 +14,7 @@ class XDAPI Texture2D
 	friend class RenderTarget2D;
 	friend class GraphicsContext;
 	friend class Shader;
+	friend class FrameCapture;
 public:
 	Texture2D(const PixelFormat &format = PixelFormat());
 	Texture2D(const uint width, const uint height, const void *data = 0, const PixelFormat &format = PixelFormat());
@@ -59,6 +60,9 @@ public:
 	void updatePixmap(const int x, const int y, const Pixmap &pixmap);
 	void clear();
 
+	// Saves the texture as a png file. The pixels are read back and written on
+	// a background thread, so the file exists a frame or two later. Call
+	// Graphics::getFrameCapture().finish() to wait for it.
 	void exportToFile(string path);
 
 	static Texture2DPtr loadResource(const string &name);
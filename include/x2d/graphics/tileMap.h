@@ -0,0 +1,86 @@
+#ifndef X2D_TILE_MAP_H
+#define X2D_TILE_MAP_H
+
+#include "../engine.h"
+#include "textureatlas.h"
+#include "vertexbuffer.h"
+
+BEGIN_XD_NAMESPACE
+
+class GraphicsContext;
+
+/*********************************************************************
+**	Tile map														**
+**********************************************************************/
+// A grid of tiles drawn from a texture atlas. Tiles are stored in square
+// chunks, and each chunk is baked into a static vertex buffer which is only
+// rebuilt when one of its tiles changes. Drawing only touches the chunks
+// inside the view, so the cost doesn't grow with the size of the map.
+class XDAPI TileMap
+{
+public:
+	// Tile id of empty tiles. Other ids are atlas indices.
+	static const ushort EMPTY_TILE = 0xFFFF;
+
+	TileMap(const TextureAtlas *atlas, const uint width, const uint height, const float tileSize, const uint chunkSize = 32);
+	~TileMap();
+
+	void setTile(const uint x, const uint y, const ushort tile);
+	ushort getTile(const uint x, const uint y) const;
+
+	// Rebuilds every chunk, eg. after the atlas has been updated
+	void setAtlas(const TextureAtlas *atlas);
+	const TextureAtlas *getAtlas() const { return m_atlas; }
+
+	uint getWidth() const { return m_width; }
+	uint getHeight() const { return m_height; }
+	float getTileSize() const { return m_tileSize; }
+	uint getChunkSize() const { return m_chunkSize; }
+
+	// Draws the chunks inside the viewport, using the current model-view matrix
+	void draw(GraphicsContext &graphicsContext);
+
+	// Draws the chunks intersecting view (in map coordinates)
+	void draw(GraphicsContext &graphicsContext, const Rect &view);
+
+	// Number of chunks drawn by the last draw()
+	uint getDrawnChunkCount() const { return m_drawnChunkCount; }
+
+private:
+	struct Chunk
+	{
+		Chunk() :
+			vertexBuffer(0),
+			quadCount(0),
+			dirty(true)
+		{
+		}
+
+		vector<ushort> tiles;
+		StaticVertexBuffer *vertexBuffer;
+		uint quadCount;
+		bool dirty;
+	};
+
+	void bake(const uint chunkX, const uint chunkY);
+
+	const TextureAtlas *m_atlas;
+	uint m_width;
+	uint m_height;
+	float m_tileSize;
+	uint m_chunkSize;
+
+	// Chunks in rows, m_chunksX by m_chunksY
+	uint m_chunksX;
+	uint m_chunksY;
+	vector<Chunk> m_chunks;
+
+	// Indices for a full chunk, shared by all chunks
+	StaticIndexBuffer *m_indexBuffer;
+
+	uint m_drawnChunkCount;
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_TILE_MAP_H
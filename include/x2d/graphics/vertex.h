@@ -28,9 +28,26 @@ enum VertexAttribute
 	VERTEX_COLOR,
 	VERTEX_TEX_COORD,
 	VERTEX_NORMAL,
+	VERTEX_TEX_SLOT,
 	VERTEX_ATTRIB_MAX
 };
 
+// Locations the attributes are bound to in the default shaders, -1 if unused
+template<VertexAttribute Attrib> struct VertexAttributeLocation { static const int value = -1; };
+template<> struct VertexAttributeLocation<VERTEX_POSITION> { static const int value = 0; };
+template<> struct VertexAttributeLocation<VERTEX_COLOR> { static const int value = 1; };
+template<> struct VertexAttributeLocation<VERTEX_TEX_COORD> { static const int value = 2; };
+template<> struct VertexAttributeLocation<VERTEX_TEX_SLOT> { static const int value = 7; };
+
+// Locations of the per-instance attributes of the instanced sprite shader
+enum SpriteInstanceLocation
+{
+	INSTANCE_RECT_LOCATION = 3,
+	INSTANCE_TRANSFORM_LOCATION = 4,
+	INSTANCE_ANGLE_LOCATION = 5,
+	INSTANCE_TEX_RECT_LOCATION = 6
+};
+
 /*********************************************************************
 **	Vertex format													**
 **********************************************************************/
@@ -38,8 +55,10 @@ class Vertex;
 class XDAPI VertexFormat
 {
 	friend class Graphics;
+	friend class GraphicsContext;
 	friend class Vertex;
 	friend class VertexBuffer;
+	friend class DynamicVertexBuffer;
 public:
 	VertexFormat();
 	VertexFormat(const VertexFormat &other);
@@ -51,6 +70,10 @@ public:
 
 	uint getVertexSizeInBytes() const;
 	uint getAttributeOffset(const VertexAttribute attrib) const;
+
+	// Packs the element count and data type of every attribute. Formats with
+	// the same layout have the same hash, and different layouts never collide.
+	uint getHash() const;
 	
 	Vertex *createVertices(const int count) const;
 	//XScriptArray *createVerticesAS(const int count) const;
@@ -60,6 +83,7 @@ public:
 
 protected:
 	static VertexFormat s_vct; // Position, color, texture coord
+	static VertexFormat s_vcts; // Position, color, texture coord, texture slot
 
 private:
 	struct Attribute
@@ -126,6 +150,33 @@ private:
 	static void Destruct(Vertex *self) { self->~Vertex(); }
 };
 
+/*********************************************************************
+**	Sprite vertex													**
+**********************************************************************/
+// Packed vertex matching VertexFormat::s_vcts. Arrays of these can be
+// handed to GL as they are, without going through Vertex.
+struct SpriteVertex
+{
+	float x, y;
+	uint color; // RGBA bytes in memory order
+	float u, v;
+	float slot; // Texture slot in the default shader
+};
+
+/*********************************************************************
+**	Sprite instance													**
+**********************************************************************/
+// Per-instance sprite data for instanced drawing. The default instanced
+// shader expands it into a quad on the GPU.
+struct SpriteInstance
+{
+	float x, y, width, height;
+	float originX, originY, scaleX, scaleY;
+	float angle; // In radians
+	float u0, v0, u1, v1;
+	uint color; // RGBA bytes in memory order
+};
+
 END_XD_NAMESPACE
 
 #endif // X2D_VERTEX_H
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef X2D_VERTEX_LAYOUT_H
+#define X2D_VERTEX_LAYOUT_H
+
+#include "../engine.h"
+#include "vertex.h"
+
+BEGIN_XD_NAMESPACE
+
+/*********************************************************************
+**	Vertex elements													**
+**********************************************************************/
+// An attribute of a vertex layout with the type and number of its components
+template<VertexAttribute Attrib, typename T, DataType Type, int Count>
+struct VertexElement
+{
+	typedef T ComponentType;
+	static const VertexAttribute attribute = Attrib;
+	static const DataType dataType = Type;
+	static const int elementCount = Count;
+	static const uint size = sizeof(T) * Count;
+};
+
+struct Position2f : VertexElement<VERTEX_POSITION, float, XD_FLOAT, 2> { };
+struct Position3f : VertexElement<VERTEX_POSITION, float, XD_FLOAT, 3> { };
+struct Color4ub : VertexElement<VERTEX_COLOR, uchar, XD_UBYTE, 4> { };
+struct Color4f : VertexElement<VERTEX_COLOR, float, XD_FLOAT, 4> { };
+struct TexCoord2f : VertexElement<VERTEX_TEX_COORD, float, XD_FLOAT, 2> { };
+struct Normal3f : VertexElement<VERTEX_NORMAL, float, XD_FLOAT, 3> { };
+struct TexSlot1f : VertexElement<VERTEX_TEX_SLOT, float, XD_FLOAT, 1> { };
+
+// Fills the unused element slots of a layout
+struct NoVertexElement
+{
+	typedef uchar ComponentType;
+	static const VertexAttribute attribute = VERTEX_ATTRIB_MAX;
+	static const DataType dataType = XD_UBYTE;
+	static const int elementCount = 0;
+	static const uint size = 0;
+};
+
+/*********************************************************************
+**	Vertex layout													**
+**********************************************************************/
+// A vertex format known at compile time. Offsets and the stride are
+// constants, so writing an element of a vertex compiles to plain stores:
+//
+//	typedef VertexLayout<Position2f, Color4ub, TexCoord2f> Layout;
+//	Layout::Vertex vertices[4];
+//	vertices[0].set<Position2f>(x, y);
+//	graphicsContext.drawPrimitives(type, Layout::getFormat(), vertices, 4);
+//
+// Elements have to be listed in VertexAttribute order, which is the order
+// VertexFormat lays attributes out in, so getFormat() describes the same bytes.
+template<class E0, class E1 = NoVertexElement, class E2 = NoVertexElement, class E3 = NoVertexElement, class E4 = NoVertexElement>
+class VertexLayout
+{
+	static_assert(E0::attribute < E1::attribute && (E1::attribute < E2::attribute || E2::elementCount == 0) &&
+		(E2::attribute < E3::attribute || E3::elementCount == 0) && (E3::attribute < E4::attribute || E4::elementCount == 0),
+		"VertexLayout: Elements have to be in VertexAttribute order without gaps");
+	static_assert(E0::elementCount > 0, "VertexLayout: The first element can't be empty");
+
+public:
+	// Byte offsets of the elements
+	static const uint offset0 = 0;
+	static const uint offset1 = offset0 + E0::size;
+	static const uint offset2 = offset1 + E1::size;
+	static const uint offset3 = offset2 + E2::size;
+	static const uint offset4 = offset3 + E3::size;
+	static const uint stride = offset4 + E4::size;
+
+	// Byte offset of element E
+	template<class E>
+	struct Offset
+	{
+		static_assert(E::elementCount > 0 &&
+			(is_same<E, E0>::value || is_same<E, E1>::value || is_same<E, E2>::value || is_same<E, E3>::value || is_same<E, E4>::value),
+			"VertexLayout: Element is not part of the layout");
+
+		static const uint value =
+			is_same<E, E0>::value ? offset0 :
+			is_same<E, E1>::value ? offset1 :
+			is_same<E, E2>::value ? offset2 :
+			is_same<E, E3>::value ? offset3 : offset4;
+	};
+
+	// A vertex in the layout. Arrays of vertices are tightly packed and can
+	// be handed to the graphics context and vertex buffers as they are.
+	// Elements aren't aligned, so components are copied in and out.
+	struct Vertex
+	{
+		template<class E>
+		void set(const typename E::ComponentType v0, const typename E::ComponentType v1 = 0, const typename E::ComponentType v2 = 0, const typename E::ComponentType v3 = 0)
+		{
+			const typename E::ComponentType components[4] = { v0, v1, v2, v3 };
+			memcpy(data + Offset<E>::value, components, E::size);
+		}
+
+		template<class E>
+		void get(typename E::ComponentType *components) const
+		{
+			memcpy(components, data + Offset<E>::value, E::size);
+		}
+
+		uchar data[stride];
+	};
+
+	// The equivalent runtime vertex format, built on first use. MSVC 2012 doesn't
+	// guard local statics, so layouts used by several threads should be used
+	// once on the main thread first.
+	static const VertexFormat &getFormat()
+	{
+		static const VertexFormat format = createFormat();
+		return format;
+	}
+
+private:
+	static VertexFormat createFormat()
+	{
+		VertexFormat format;
+		addElement<E0>(format);
+		addElement<E1>(format);
+		addElement<E2>(format);
+		addElement<E3>(format);
+		addElement<E4>(format);
+		return format;
+	}
+
+	template<class E>
+	static void addElement(VertexFormat &format)
+	{
+		if(E::elementCount > 0)
+		{
+			format.set(E::attribute, E::elementCount, E::dataType);
+		}
+	}
+};
+
+END_XD_NAMESPACE
+
+#endif // X2D_VERTEX_LAYOUT_H
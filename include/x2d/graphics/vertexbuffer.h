@@ -6,6 +6,7 @@
 BEGIN_XD_NAMESPACE
 
 class Vertex;
+struct SpriteVertex;
 
 /*********************************************************************
 **	Vertex buffer													**
@@ -16,6 +17,8 @@ class XDAPI VertexBuffer
 public:
 	// Add vertices and indices to the batch
 	void setData(const Vertex *vertices, const uint vertexCount);
+	void setData(const SpriteVertex *vertices, const uint vertexCount);
+	void setData(const VertexFormat &fmt, const void *vertices, const uint vertexCount); // Vertices packed in fmt
 	char *getData() const;
 
 	// Get vertex/vertex format/vertex count
@@ -54,6 +57,7 @@ public:
 	DynamicVertexBuffer(const Vertex *vertices, const uint vertexCount);
 
 	void modifyData(const uint startIdx, Vertex *vertex, const uint vertexCount);
+	void modifyData(const uint startIdx, const SpriteVertex *vertices, const uint vertexCount);
 };
 
 class XDAPI StaticVertexBuffer : public VertexBuffer
@@ -115,6 +119,66 @@ public:
 	StaticIndexBuffer(const uint *vertices, const uint indexCount);
 };
 
+/*********************************************************************
+**	Stream buffer													**
+**********************************************************************/
+// A ring buffer for data that is written once and drawn once. Each write
+// maps the next free range without synchronizing, so earlier draws reading
+// the buffer don't stall the upload. Ranges still in use by the GPU are
+// guarded by fences, and are waited for when the ring wraps around onto
+// them. Without fence support the buffer is orphaned on wraparound instead.
+class XDAPI StreamBuffer
+{
+public:
+	StreamBuffer(const GLenum target, const uint size);
+	~StreamBuffer();
+
+	// Maps size bytes at an offset that is a multiple of alignment, and returns
+	// the pointer to write them to. Has to be unmapped before drawing. If the
+	// driver fails to map the range, the data is written to system memory and
+	// uploaded with glBufferSubData() by unmap().
+	void *map(const uint size, const uint alignment, uint &offset);
+	void unmap();
+
+	// Fences the data written since the last fence. Called once per frame.
+	void fence();
+
+	GLuint getId() const { return m_id; }
+	uint getSize() const { return m_size; }
+
+private:
+	// Reallocates the storage, leaving the old storage to the draws using it
+	void orphan();
+
+	// Waits for the fenced ranges overlapping [begin, end)
+	void waitForRange(const uint begin, const uint end);
+
+	struct Fence
+	{
+		GLsync sync;
+		uint begin;
+		uint end;
+	};
+
+	GLenum m_target;
+	GLuint m_id;
+	uint m_size;
+
+	// Write position, and the start of the data written since the last fence
+	uint m_head;
+	uint m_fenceBegin;
+
+	// Fenced ranges, oldest first
+	deque<Fence> m_fences;
+	bool m_useFences;
+
+	// Data written while mapping fails, and where unmap() uploads it to
+	vector<uchar> m_fallbackData;
+	uint m_fallbackOffset;
+	bool m_fallbackMapped;
+	bool m_mapFailed;
+};
+
 END_XD_NAMESPACE
 
 #endif // X2D_VERTEX_BUFFER_H
\ No newline at end of file
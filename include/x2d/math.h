@@ -114,6 +114,10 @@ namespace math
 	XDAPI int mod(const int a, const int b);
 	XDAPI uint ror(const uint a, const uint b);
 	XDAPI uint rol(const uint a, const uint b);
+
+	// Sorting
+	XDAPI uint floatToSortKey(const float v); // Maps floats to uints with the same ordering
+	XDAPI uint64_t *radixSort(uint64_t *keys, uint64_t *scratch, const uint count, const uint firstByte = 0); // Returns keys or scratch, whichever holds the result
 }
 
 END_XD_NAMESPACE
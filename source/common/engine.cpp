@@ -83,7 +83,9 @@ Engine *CreateEngine()
 bool Engine::s_initialized = false;
 bool Engine::s_paused = false;
 bool Engine::s_running = false;
+bool Engine::s_exiting = false;
 Game * Engine::s_game = 0;
+WorkerPool * Engine::s_workerPool = 0;
 
 Engine::Engine()
 {
@@ -98,6 +100,8 @@ Engine::~Engine()
 	delete m_audio;
 	delete m_timer;
 	delete m_console;
+	delete s_workerPool;
+	s_workerPool = 0;
 }
 
 // Convert a wide Unicode string to an UTF8 string
@@ -166,7 +170,12 @@ int Engine::init(Game * game)
 		{
 			flags |= XD_VERBOSE;
 		}
+		else if(arg == "-headless")
+		{
+			flags |= XD_HEADLESS;
+		}
 	}
+	game->setFlags(flags);
 
 	// Set current directory to exe location
 	{
@@ -205,6 +214,7 @@ int Engine::init(Game * game)
 	}
 
 	m_timer = new Timer();
+	s_workerPool = new WorkerPool();
 	m_graphics = new Graphics();
 	m_audio = new AudioManager();
 
@@ -212,7 +222,7 @@ int Engine::init(Game * game)
 
 	glfwSetErrorCallback(error_callback);
 
-	if(!glfwInit())
+	if(!isEnabled(XD_HEADLESS) && !glfwInit())
 	{
 		assert("GLFW could not initialize");
 	}
@@ -248,6 +258,7 @@ int Engine::init(Game * game)
 
 void Engine::exit()
 {
+	s_exiting = true;
 	Window::close();
 }
 
@@ -285,10 +296,13 @@ int Engine::run()
 		s_game->update(dt);
 
 		// Game loop
-		while(!glfwWindowShouldClose(Window::s_window))
+		while(!s_exiting && (!Window::s_window || !glfwWindowShouldClose(Window::s_window)))
 		{
 			// Process game events
-			glfwPollEvents();
+			if(Window::s_window)
+			{
+				glfwPollEvents();
+			}
 
 			// Check if game is paused or out of focus
 			if(s_paused || (!isEnabled(XD_RUN_IN_BACKGROUND) && !Window::hasFocus()))
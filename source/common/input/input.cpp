@@ -211,14 +211,14 @@ void Input::init(string file)
 
 Vector2i Input::getCursorPos()
 {
-	double x, y;
-	glfwGetCursorPos(Window::s_window, &x, &y);
+	double x = 0.0, y = 0.0;
+	if(Window::s_window) glfwGetCursorPos(Window::s_window, &x, &y);
 	return Vector2i((int) x, (int) y);
 }
 
 void Input::setCursorPos(const Vector2i &pos)
 {
-	glfwSetCursorPos(Window::s_window, pos.x, pos.y);
+	if(Window::s_window) glfwSetCursorPos(Window::s_window, pos.x, pos.y);
 }
 
 void Input::setCursorLimits(const Recti &area)
@@ -270,12 +270,14 @@ InputContext * Input::getContext(const string & name)
 
 string Input::getClipboardString()
 {
-	return glfwGetClipboardString(Window::s_window);
+	if(!Window::s_window) return "";
+	const char *str = glfwGetClipboardString(Window::s_window);
+	return str ? str : "";
 }
 
 void Input::setClipboardString(const string str)
 {
-	glfwSetClipboardString(Window::s_window, str.c_str());
+	if(Window::s_window) glfwSetClipboardString(Window::s_window, str.c_str());
 }
 
 void Input::updateBindings()
@@ -293,7 +295,7 @@ int Input::getKeyState(const VirtualKey key)
 	{
 		return s_mouseButtonState[key];
 	}
-	return glfwGetKey(Window::s_window, key);
+	return Window::s_window ? glfwGetKey(Window::s_window, key) : 0;
 }
 
 END_XD_NAMESPACE
\ No newline at end of file
@@ -128,6 +128,64 @@ int mod(const int a, const int b)
 	return r < 0 ? r + b : r;
 }
 
+uint floatToSortKey(const float v)
+{
+	// Adding 0 turns -0 into 0 so that both produce the same key
+	const float f = v + 0.0f;
+	uint bits;
+	memcpy(&bits, &f, sizeof(uint));
+
+	// Flip every bit of negative floats and only the sign bit of positive ones
+	return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+uint64_t *radixSort(uint64_t *keys, uint64_t *scratch, const uint count, const uint firstByte)
+{
+	// Count the byte values of every key in a single pass
+	uint histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for(uint i = 0; i < count; ++i)
+	{
+		const uint64_t key = keys[i];
+		for(uint b = firstByte; b < 8; ++b)
+		{
+			++histograms[b][(key >> (b * 8)) & 0xFF];
+		}
+	}
+
+	// Do a stable counting sort per byte, least significant byte first
+	uint64_t *src = keys, *dst = scratch;
+	for(uint b = firstByte; b < 8 && count > 0; ++b)
+	{
+		uint *histogram = histograms[b];
+		const uint shift = b * 8;
+
+		// Skip the pass if all keys share this byte
+		if(histogram[(src[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		// Convert counts into bucket offsets
+		uint offset = 0;
+		for(uint i = 0; i < 256; ++i)
+		{
+			const uint bucketSize = histogram[i];
+			histogram[i] = offset;
+			offset += bucketSize;
+		}
+
+		// Scatter keys into their buckets
+		for(uint i = 0; i < count; ++i)
+		{
+			const uint64_t key = src[i];
+			dst[histogram[(key >> shift) & 0xFF]++] = key;
+		}
+		swap(src, dst);
+	}
+	return src;
+}
+
 }
 
 END_XD_NAMESPACE
\ No newline at end of file
@@ -19,6 +19,7 @@ BEGIN_XD_NAMESPACE
 #define WINDOW_TITLE "x2D Game Engine"
 
 GLFWwindow *Window::s_window = 0;
+Vector2i Window::s_headlessSize(0, 0);
 //vector<Vector2i> Window::s_resolutions;
 bool Window::s_focus = true;
 bool Window::s_fullScreen = false;
@@ -47,6 +48,12 @@ WindowListener::~WindowListener()
 
 void Window::init(int w, int h, bool fs)
 {
+	if(Engine::isEnabled(XD_HEADLESS))
+	{
+		s_headlessSize.set(w, h);
+		return;
+	}
+
 	if(!s_window)
 	{
 		// Create window
@@ -86,7 +93,7 @@ void Window::init(int w, int h, bool fs)
 
 void Window::close()
 {
-	glfwDestroyWindow(s_window);
+	if(s_window) glfwDestroyWindow(s_window);
 }
 
 // Exception
@@ -107,7 +114,7 @@ void Window::setFullScreen(const bool fullScreen)
 	//int count;
 	//const GLFWvidmode* modes = glfwGetVideoModes(glfwGetPrimaryMonitor(), &count);
 
-	if(s_fullScreen != fullScreen)
+	if(s_window && s_fullScreen != fullScreen)
 	{
 		// Get window size
 		const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
@@ -126,6 +133,7 @@ bool Window::getFullScreen()
 
 void Window::setResizable(const bool resizable)
 {
+	if(!s_window) return;
 	glfwWindowHint(GLFW_RESIZABLE, resizable);
 	glfwShowWindow(s_window);
 }
@@ -143,12 +151,19 @@ bool Window::hasFocus()
 Vector2i Window::getPosition()
 {
 	int x = -1, y = -1;
-	glfwGetWindowPos(s_window, &x, &y);
+	if(s_window) glfwGetWindowPos(s_window, &x, &y);
 	return Vector2i(x, y);
 }
 
 void Window::setSize(const int width, const int height)
 {
+	if(!s_window)
+	{
+		// Resize right away, like the window callback would
+		s_headlessSize.set(width, height);
+		sizeChanged(nullptr, width, height);
+		return;
+	}
 	glfwSetWindowSize(s_window, width, height);
 }
 
@@ -168,21 +183,22 @@ void Window::setHeight(const int height)
 
 void Window::minimize()
 {
-	glfwIconifyWindow(s_window);
+	if(s_window) glfwIconifyWindow(s_window);
 }
 
 void Window::setPosition(const Vector2i &pos)
 {
-	glfwSetWindowPos(s_window, pos.x, pos.y);
+	if(s_window) glfwSetWindowPos(s_window, pos.x, pos.y);
 }
 
 void Window::restore()
 {
-	glfwRestoreWindow(s_window);
+	if(s_window) glfwRestoreWindow(s_window);
 }
 
 Vector2i Window::getSize()
 {
+	if(!s_window) return s_headlessSize;
 	int w = -1, h = -1;
 	glfwGetWindowSize(s_window, &w, &h);
 	return Vector2i(w, h);
@@ -190,6 +206,7 @@ Vector2i Window::getSize()
 
 int Window::getWidth()
 {
+	if(!s_window) return s_headlessSize.x;
 	int w = -1, h = -1;
 	glfwGetWindowSize(s_window, &w, &h);
 	return w;
@@ -197,6 +214,7 @@ int Window::getWidth()
 
 int Window::getHeight()
 {
+	if(!s_window) return s_headlessSize.y;
 	int w = -1, h = -1;
 	glfwGetWindowSize(s_window, &w, &h);
 	return h;
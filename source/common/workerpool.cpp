@@ -0,0 +1,122 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+
+BEGIN_XD_NAMESPACE
+
+WorkerPool::WorkerPool(const int threadCount) :
+	m_func(0),
+	m_count(0),
+	m_chunkSize(1),
+	m_nextChunk(0),
+	m_job(0),
+	m_pendingWorkers(0),
+	m_quit(false)
+{
+	uint count = threadCount;
+	if(threadCount < 0)
+	{
+		// The calling thread takes part as well
+		const uint cores = thread::hardware_concurrency();
+		count = cores > 1 ? cores - 1 : 0;
+	}
+
+	for(uint i = 0; i < count; ++i)
+	{
+		m_threads.push_back(thread(&WorkerPool::workerMain, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_workCondition.notify_all();
+
+	for(uint i = 0; i < m_threads.size(); ++i)
+	{
+		m_threads[i].join();
+	}
+}
+
+void WorkerPool::parallelFor(const uint count, const uint chunkSize, const function<void(uint, uint)> &func)
+{
+	const uint size = max(chunkSize, 1u);
+
+	// Not worth waking the workers for a single chunk. The pool is not reentrant and runs
+	// one job at a time, so jobs from other threads, or from inside a job, run serially
+	// on the calling thread.
+	unique_lock<mutex> jobLock(m_jobMutex, defer_lock);
+	if(m_threads.empty() || count <= size || !jobLock.try_lock())
+	{
+		if(count > 0)
+		{
+			func(0, count);
+		}
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_func = &func;
+		m_count = count;
+		m_chunkSize = size;
+		m_nextChunk = 0;
+		m_pendingWorkers = m_threads.size();
+		++m_job;
+	}
+	m_workCondition.notify_all();
+
+	runChunks();
+
+	// Wait for every worker to finish, so none of them reads the job after we return
+	unique_lock<mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return m_pendingWorkers == 0; });
+	m_func = 0;
+}
+
+void WorkerPool::runChunks()
+{
+	const uint chunkCount = (m_count + m_chunkSize - 1) / m_chunkSize;
+	for(uint chunk = m_nextChunk++; chunk < chunkCount; chunk = m_nextChunk++)
+	{
+		const uint begin = chunk * m_chunkSize;
+		(*m_func)(begin, min(begin + m_chunkSize, m_count));
+	}
+}
+
+void WorkerPool::workerMain()
+{
+	uint job = 0;
+	while(true)
+	{
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_workCondition.wait(lock, [&]() { return m_quit || m_job != job; });
+			if(m_quit)
+			{
+				return;
+			}
+			job = m_job;
+		}
+
+		runChunks();
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			--m_pendingWorkers;
+		}
+		m_doneCondition.notify_one();
+	}
+}
+
+END_XD_NAMESPACE
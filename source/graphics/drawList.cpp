@@ -0,0 +1,411 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+BEGIN_XD_NAMESPACE
+
+DrawList::DrawList(const uint width, const uint height) :
+	m_commandCount(0),
+	m_width(width),
+	m_height(height),
+	m_graphicsContext(0)
+{
+	clear();
+}
+
+DrawList::~DrawList()
+{
+	delete m_graphicsContext;
+}
+
+void DrawList::clear()
+{
+	m_data.clear();
+	m_commandCount = 0;
+	m_textures.clear();
+	m_shaders.clear();
+	m_vertices.clear();
+
+	delete m_graphicsContext;
+	m_graphicsContext = new GraphicsContext(this);
+	m_graphicsContext->setProjection(m_width, m_height);
+}
+
+void DrawList::writeCommand(const Command command)
+{
+	m_data.push_back((uchar) command);
+	++m_commandCount;
+}
+
+void DrawList::write(const void *data, const uint size)
+{
+	const uint offset = m_data.size();
+	m_data.resize(offset + size);
+	if(size > 0)
+	{
+		memcpy(&m_data[offset], data, size);
+	}
+}
+
+void DrawList::writeArray(const void *data, const uint size, const uint alignment)
+{
+	const uint padding = (alignment - m_data.size() % alignment) % alignment;
+	m_data.resize(m_data.size() + padding);
+	write(data, size);
+}
+
+const uchar *DrawList::readArray(const uchar *&data, const uint size, const uint alignment)
+{
+	const uchar *array = (const uchar*) (((uintptr) data + alignment - 1) & ~(uintptr) (alignment - 1));
+	data = array + size;
+	return array;
+}
+
+void DrawList::writeFormat(const VertexFormat &fmt)
+{
+	for(int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+	{
+		const VertexAttribute attrib = VertexAttribute(i);
+		write(fmt.getElementCount(attrib));
+		write(fmt.getDataType(attrib));
+	}
+}
+
+void DrawList::readFormat(const uchar *&data, VertexFormat &fmt)
+{
+	for(int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+	{
+		const int elementCount = read<int>(data);
+		const DataType dataType = read<DataType>(data);
+		if(elementCount > 0)
+		{
+			fmt.set(VertexAttribute(i), elementCount, dataType);
+		}
+	}
+}
+
+void DrawList::recordEnable(const GraphicsContext::Capability cap, const bool enable)
+{
+	writeCommand(enable ? CMD_ENABLE : CMD_DISABLE);
+	write(cap);
+}
+
+void DrawList::recordClear(const uint mask, const Color &fillColor)
+{
+	writeCommand(CMD_CLEAR);
+	write(mask);
+	write(fillColor);
+}
+
+void DrawList::recordSetRenderTarget(RenderTarget2D *renderTarget)
+{
+	writeCommand(CMD_SET_RENDER_TARGET);
+	write(renderTarget);
+}
+
+void DrawList::recordSwitchRenderTarget(RenderTarget2D *renderTarget)
+{
+	writeCommand(CMD_SWITCH_RENDER_TARGET);
+	write(renderTarget);
+}
+
+void DrawList::recordResizeViewport(const uint w, const uint h)
+{
+	writeCommand(CMD_RESIZE_VIEWPORT);
+	write(w);
+	write(h);
+}
+
+void DrawList::recordSetModelViewMatrix(const Matrix4 &mat)
+{
+	writeCommand(CMD_SET_MODEL_VIEW_MATRIX);
+	write(mat.get(), sizeof(float) * 16);
+}
+
+void DrawList::recordPushMatrix(const Matrix4 &mat)
+{
+	writeCommand(CMD_PUSH_MATRIX);
+	write(mat.get(), sizeof(float) * 16);
+}
+
+void DrawList::recordPopMatrix()
+{
+	writeCommand(CMD_POP_MATRIX);
+}
+
+void DrawList::recordSetTexture(const uint slot, const Texture2DPtr texture)
+{
+	// Consecutive commands mostly reuse the last texture
+	uint index = NULL_RESOURCE;
+	if(texture)
+	{
+		if(m_textures.empty() || m_textures.back() != texture)
+		{
+			m_textures.push_back(texture);
+		}
+		index = m_textures.size() - 1;
+	}
+
+	writeCommand(CMD_SET_TEXTURE);
+	write(slot);
+	write(index);
+}
+
+void DrawList::recordSetShader(const ShaderPtr shader)
+{
+	uint index = NULL_RESOURCE;
+	if(shader)
+	{
+		if(m_shaders.empty() || m_shaders.back() != shader)
+		{
+			m_shaders.push_back(shader);
+		}
+		index = m_shaders.size() - 1;
+	}
+
+	writeCommand(CMD_SET_SHADER);
+	write(index);
+}
+
+void DrawList::recordSetBlendState(const BlendState &blendState)
+{
+	writeCommand(CMD_SET_BLEND_STATE);
+	write(blendState);
+}
+
+void DrawList::recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const Vertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount)
+{
+	// Vertex objects own their data, so they are copied aside
+	writeCommand(CMD_DRAW_INDEXED_VERTICES);
+	write(type);
+	write((uint) m_vertices.size());
+	write(vertexCount);
+	write(indexCount);
+	writeArray(indices, indexCount);
+	m_vertices.insert(m_vertices.end(), vertices, vertices + vertexCount);
+}
+
+void DrawList::recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const SpriteVertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount)
+{
+	writeCommand(CMD_DRAW_INDEXED_SPRITE_VERTICES);
+	write(type);
+	write(vertexCount);
+	write(indexCount);
+	writeArray(vertices, vertexCount);
+	writeArray(indices, indexCount);
+}
+
+void DrawList::recordDrawSpriteInstances(const SpriteInstance *instances, const uint instanceCount)
+{
+	writeCommand(CMD_DRAW_SPRITE_INSTANCES);
+	write(instanceCount);
+	writeArray(instances, instanceCount);
+}
+
+void DrawList::recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const VertexBuffer *vbo, const IndexBuffer *ibo, const uint indexOffset, const uint indexCount)
+{
+	writeCommand(CMD_DRAW_INDEXED_BUFFERS);
+	write(type);
+	write(vbo);
+	write(ibo);
+	write(indexOffset);
+	write(indexCount);
+}
+
+void DrawList::recordDrawPrimitives(const GraphicsContext::PrimitiveType type, const Vertex *vertices, const uint vertexCount)
+{
+	writeCommand(CMD_DRAW_VERTICES);
+	write(type);
+	write((uint) m_vertices.size());
+	write(vertexCount);
+	m_vertices.insert(m_vertices.end(), vertices, vertices + vertexCount);
+}
+
+void DrawList::recordDrawPrimitives(const GraphicsContext::PrimitiveType type, const VertexBuffer *vbo)
+{
+	writeCommand(CMD_DRAW_VERTEX_BUFFER);
+	write(type);
+	write(vbo);
+}
+
+void DrawList::recordDrawIndexedPrimitives(const GraphicsContext::PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount, const uint *indices, const uint indexCount)
+{
+	writeCommand(CMD_DRAW_INDEXED_PACKED_VERTICES);
+	write(type);
+	writeFormat(fmt);
+	write(vertexCount);
+	write(indexCount);
+	writeArray(vertices, vertexCount * fmt.getVertexSizeInBytes(), alignment_of<float>::value);
+	writeArray(indices, indexCount);
+}
+
+void DrawList::recordDrawPrimitives(const GraphicsContext::PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount)
+{
+	writeCommand(CMD_DRAW_PACKED_VERTICES);
+	write(type);
+	writeFormat(fmt);
+	write(vertexCount);
+	writeArray(vertices, vertexCount * fmt.getVertexSizeInBytes(), alignment_of<float>::value);
+}
+
+void DrawList::replay(GraphicsContext &graphicsContext) const
+{
+	if(graphicsContext.m_drawList == this)
+	{
+		LOG("DrawList::replay(): Can't replay a draw list into itself");
+		return;
+	}
+
+	const uchar *data = m_data.data(), *end = data + m_data.size();
+	while(data < end)
+	{
+		const Command command = (Command) read<uchar>(data);
+		switch(command)
+		{
+		case CMD_ENABLE: graphicsContext.enable(read<GraphicsContext::Capability>(data)); break;
+		case CMD_DISABLE: graphicsContext.disable(read<GraphicsContext::Capability>(data)); break;
+
+		case CMD_CLEAR:
+			{
+				const uint mask = read<uint>(data);
+				graphicsContext.clear(mask, read<Color>(data));
+			}
+			break;
+
+		case CMD_SET_RENDER_TARGET: graphicsContext.setRenderTarget(read<RenderTarget2D*>(data)); break;
+		case CMD_SWITCH_RENDER_TARGET: graphicsContext.switchRenderTarget(read<RenderTarget2D*>(data)); break;
+
+		case CMD_RESIZE_VIEWPORT:
+			{
+				const uint w = read<uint>(data);
+				graphicsContext.resizeViewport(w, read<uint>(data));
+			}
+			break;
+
+		case CMD_SET_MODEL_VIEW_MATRIX:
+		case CMD_PUSH_MATRIX:
+			{
+				float mat[16];
+				read(data, mat);
+				if(command == CMD_SET_MODEL_VIEW_MATRIX)
+				{
+					graphicsContext.setModelViewMatrix(Matrix4(mat));
+				}
+				else
+				{
+					graphicsContext.pushMatrix(Matrix4(mat));
+				}
+			}
+			break;
+
+		case CMD_POP_MATRIX: graphicsContext.popMatrix(); break;
+
+		case CMD_SET_TEXTURE:
+			{
+				const uint slot = read<uint>(data), index = read<uint>(data);
+				graphicsContext.setTexture(slot, index == NULL_RESOURCE ? nullptr : m_textures[index]);
+			}
+			break;
+
+		case CMD_SET_SHADER:
+			{
+				const uint index = read<uint>(data);
+				graphicsContext.setShader(index == NULL_RESOURCE ? nullptr : m_shaders[index]);
+			}
+			break;
+
+		case CMD_SET_BLEND_STATE:
+			{
+				BlendState blendState(BlendState::PRESET_ALPHA_BLEND);
+				read(data, blendState);
+				graphicsContext.setBlendState(blendState);
+			}
+			break;
+
+		case CMD_DRAW_INDEXED_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = read<GraphicsContext::PrimitiveType>(data);
+				const uint firstVertex = read<uint>(data), vertexCount = read<uint>(data), indexCount = read<uint>(data);
+				const uint *indices = readArray<uint>(data, indexCount);
+				graphicsContext.drawIndexedPrimitives(type, &m_vertices[firstVertex], vertexCount, indices, indexCount);
+			}
+			break;
+
+		case CMD_DRAW_INDEXED_SPRITE_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = read<GraphicsContext::PrimitiveType>(data);
+				const uint vertexCount = read<uint>(data), indexCount = read<uint>(data);
+				const SpriteVertex *vertices = readArray<SpriteVertex>(data, vertexCount);
+				const uint *indices = readArray<uint>(data, indexCount);
+				graphicsContext.drawIndexedPrimitives(type, vertices, vertexCount, indices, indexCount);
+			}
+			break;
+
+		case CMD_DRAW_SPRITE_INSTANCES:
+			{
+				const uint instanceCount = read<uint>(data);
+				const SpriteInstance *instances = readArray<SpriteInstance>(data, instanceCount);
+				graphicsContext.drawSpriteInstances(instances, instanceCount);
+			}
+			break;
+
+		case CMD_DRAW_INDEXED_BUFFERS:
+			{
+				const GraphicsContext::PrimitiveType type = read<GraphicsContext::PrimitiveType>(data);
+				const VertexBuffer *vbo = read<const VertexBuffer*>(data);
+				const IndexBuffer *ibo = read<const IndexBuffer*>(data);
+				const uint indexOffset = read<uint>(data), indexCount = read<uint>(data);
+				graphicsContext.drawIndexedPrimitives(type, vbo, ibo, indexOffset, indexCount);
+			}
+			break;
+
+		case CMD_DRAW_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = read<GraphicsContext::PrimitiveType>(data);
+				const uint firstVertex = read<uint>(data), vertexCount = read<uint>(data);
+				graphicsContext.drawPrimitives(type, &m_vertices[firstVertex], vertexCount);
+			}
+			break;
+
+		case CMD_DRAW_VERTEX_BUFFER:
+			{
+				const GraphicsContext::PrimitiveType type = read<GraphicsContext::PrimitiveType>(data);
+				graphicsContext.drawPrimitives(type, read<const VertexBuffer*>(data));
+			}
+			break;
+
+		case CMD_DRAW_INDEXED_PACKED_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = read<GraphicsContext::PrimitiveType>(data);
+				VertexFormat fmt;
+				readFormat(data, fmt);
+				const uint vertexCount = read<uint>(data), indexCount = read<uint>(data);
+				const void *vertices = readArray(data, vertexCount * fmt.getVertexSizeInBytes(), alignment_of<float>::value);
+				const uint *indices = readArray<uint>(data, indexCount);
+				graphicsContext.drawIndexedPrimitives(type, fmt, vertices, vertexCount, indices, indexCount);
+			}
+			break;
+
+		case CMD_DRAW_PACKED_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = read<GraphicsContext::PrimitiveType>(data);
+				VertexFormat fmt;
+				readFormat(data, fmt);
+				const uint vertexCount = read<uint>(data);
+				const void *vertices = readArray(data, vertexCount * fmt.getVertexSizeInBytes(), alignment_of<float>::value);
+				graphicsContext.drawPrimitives(type, fmt, vertices, vertexCount);
+			}
+			break;
+		}
+	}
+}
+
+END_XD_NAMESPACE
@@ -0,0 +1,267 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+#include <freeimage.h>
+
+BEGIN_XD_NAMESPACE
+
+FrameCapture::FrameCapture() :
+	m_useFences(Graphics::isGLVersionSupported(3, 2)),
+	m_frame(0),
+	m_sequenceInterval(0),
+	m_sequenceFrame(0),
+	m_sequenceIndex(0),
+	m_writingCount(0),
+	m_quit(false)
+{
+	m_thread = thread(&FrameCapture::writerMain, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+	finish();
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_imageCondition.notify_all();
+	m_thread.join();
+
+	for(uint i = 0; i < m_freePixelBuffers.size(); ++i)
+	{
+		glDeleteBuffers(1, &m_freePixelBuffers[i].first);
+	}
+}
+
+void FrameCapture::saveScreenshot(const string &path)
+{
+	readFramebuffer(GL_FRONT, path);
+}
+
+void FrameCapture::saveTexture(const Texture2D &texture, const string &path)
+{
+	// NOTE: Integer textures would have to be read as GL_BGRA_INTEGER
+	if(texture.m_pixelFormat.getDataType() != PixelFormat::BYTE && texture.m_pixelFormat.getDataType() != PixelFormat::UNSIGNED_BYTE)
+	{
+		LOG("FrameCapture::saveTexture(): Cannot export image with a pixel data type different from byte or unsigned byte");
+		return;
+	}
+
+	Readback readback = beginReadback(texture.m_width, texture.m_height, 32, path);
+	GraphicsContext::bindTexture(texture.m_id);
+	GL_CALL(glGetTexImage(GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_BYTE, 0));
+	endReadback(readback);
+}
+
+void FrameCapture::startSequence(const string &path, const uint frameInterval)
+{
+	m_sequencePath = path;
+	m_sequenceInterval = max(frameInterval, 1u);
+	m_sequenceFrame = 0;
+	m_sequenceIndex = 0;
+}
+
+void FrameCapture::stopSequence()
+{
+	m_sequenceInterval = 0;
+}
+
+void FrameCapture::finish()
+{
+	while(!m_readbacks.empty())
+	{
+		completeReadback(m_readbacks.front(), true);
+		m_readbacks.pop_front();
+	}
+
+	unique_lock<mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return m_images.empty() && m_writingCount == 0; });
+}
+
+uint FrameCapture::getPendingCount() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_readbacks.size() + m_images.size() + m_writingCount;
+}
+
+void FrameCapture::update()
+{
+	// Hand over the readbacks the GPU has finished. Readbacks are waited for
+	// when they are two frames old, so captures are never held back longer.
+	while(!m_readbacks.empty() && completeReadback(m_readbacks.front(), m_frame - m_readbacks.front().frame >= 2))
+	{
+		m_readbacks.pop_front();
+	}
+
+	// The back buffer holds the finished frame until the buffers are swapped
+	if(m_sequenceInterval > 0 && m_sequenceFrame++ % m_sequenceInterval == 0)
+	{
+		char fileName[16];
+		sprintf(fileName, "%05u.png", m_sequenceIndex++);
+		readFramebuffer(GL_BACK, m_sequencePath + fileName);
+	}
+
+	++m_frame;
+}
+
+FrameCapture::Readback FrameCapture::beginReadback(const uint width, const uint height, const uint bitsPerPixel, const string &path)
+{
+	Readback readback;
+	readback.size = width * height * bitsPerPixel / 8;
+	readback.pixelBuffer = 0;
+	readback.fence = 0;
+	readback.frame = m_frame;
+	readback.width = width;
+	readback.height = height;
+	readback.bitsPerPixel = bitsPerPixel;
+	readback.path = path;
+	util::toAbsoluteFilePath(readback.path);
+
+	// Reuse a pixel buffer if one is large enough
+	for(uint i = 0; i < m_freePixelBuffers.size(); ++i)
+	{
+		if(m_freePixelBuffers[i].second >= readback.size)
+		{
+			readback.pixelBuffer = m_freePixelBuffers[i].first;
+			readback.size = m_freePixelBuffers[i].second;
+			m_freePixelBuffers.erase(m_freePixelBuffers.begin() + i);
+			break;
+		}
+	}
+
+	if(readback.pixelBuffer == 0)
+	{
+		GL_CALL(glGenBuffers(1, &readback.pixelBuffer));
+		GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer));
+		GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, readback.size, 0, GL_STREAM_READ));
+	}
+	else
+	{
+		GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer));
+	}
+
+	// Rows are tightly packed
+	GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+	return readback;
+}
+
+void FrameCapture::endReadback(Readback &readback)
+{
+	GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+
+	// Other reads of pixels go to client memory
+	GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+	if(m_useFences)
+	{
+		readback.fence = GL_CALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	}
+	m_readbacks.push_back(readback);
+}
+
+void FrameCapture::readFramebuffer(const GLenum buffer, const string &path)
+{
+	const Vector2i size = Window::getSize();
+	Readback readback = beginReadback(size.x, size.y, 24, path);
+	GL_CALL(glReadBuffer(buffer));
+	GL_CALL(glReadPixels(0, 0, size.x, size.y, GL_BGR, GL_UNSIGNED_BYTE, 0));
+	GL_CALL(glReadBuffer(GL_BACK));
+	endReadback(readback);
+}
+
+bool FrameCapture::completeReadback(Readback &readback, const bool wait)
+{
+	if(readback.fence)
+	{
+		const GLenum result = GL_CALL(glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0));
+		if(result == GL_TIMEOUT_EXPIRED && !wait)
+		{
+			return false;
+		}
+		GL_CALL(glDeleteSync(readback.fence));
+		readback.fence = 0;
+	}
+	else if(!wait)
+	{
+		// Without fences, the read is assumed done after two frames
+		return false;
+	}
+
+	// Copy the pixels out, so the pixel buffer can be reused right away
+	Image image;
+	image.width = readback.width;
+	image.height = readback.height;
+	image.bitsPerPixel = readback.bitsPerPixel;
+	image.path = readback.path;
+	const uint size = image.width * image.height * image.bitsPerPixel / 8;
+	image.data = new uchar[size];
+
+	GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer));
+	const void *data = GL_CALL(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+	if(data)
+	{
+		memcpy(image.data, data, size);
+		GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+	}
+	GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+	m_freePixelBuffers.push_back(make_pair(readback.pixelBuffer, readback.size));
+
+	if(!data)
+	{
+		LOG("FrameCapture: Failed to map the pixels of '%s'", image.path.c_str());
+		delete[] image.data;
+		return true;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_images.push(image);
+	}
+	m_imageCondition.notify_one();
+	return true;
+}
+
+void FrameCapture::writerMain()
+{
+	while(true)
+	{
+		Image image;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_imageCondition.wait(lock, [this]() { return m_quit || !m_images.empty(); });
+			if(m_images.empty())
+			{
+				return;
+			}
+			image = m_images.front();
+			m_images.pop();
+			++m_writingCount;
+		}
+
+		// For now, let's just save everything as png
+		FIBITMAP *bitmap = FreeImage_ConvertFromRawBits(image.data, image.width, image.height, image.width * image.bitsPerPixel / 8, image.bitsPerPixel, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, false);
+		if(!FreeImage_Save(FIF_PNG, bitmap, image.path.c_str(), PNG_DEFAULT))
+		{
+			LOG("FrameCapture: Failed to save '%s'", image.path.c_str());
+		}
+		FreeImage_Unload(bitmap);
+		delete[] image.data;
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			--m_writingCount;
+		}
+		m_doneCondition.notify_all();
+	}
+}
+
+END_XD_NAMESPACE
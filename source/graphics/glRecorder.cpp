@@ -0,0 +1,692 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+BEGIN_XD_NAMESPACE
+
+bool GLRecorder::s_installed = false;
+
+/*********************************************************************
+**	Recorded GL objects and state									**
+**********************************************************************/
+
+struct RecordedUniform
+{
+	string name;
+	GLenum type;
+	GLint size;
+};
+
+struct RecordedProgram
+{
+	vector<GLuint> shaders;
+	vector<RecordedUniform> uniforms;
+};
+
+struct RecordedState
+{
+	GLuint nextName;
+
+	map<GLuint, vector<uchar>> buffers;
+	map<GLuint, Vector2i> textures;
+	map<GLuint, string> shaders;
+	map<GLuint, RecordedProgram> programs;
+	set<GLuint> framebuffers;
+	map<GLuint, GLuint> vertexArrays; // Element array buffer of each vertex array
+
+	GLuint arrayBuffer;
+	GLuint pixelPackBuffer;
+	GLuint pixelUnpackBuffer;
+	GLuint otherBuffer; // Bound to any other target
+	GLuint vertexArray;
+	GLuint program;
+	GLuint framebuffer;
+	uint activeTexture;
+	GLuint boundTextures[32];
+	GLint packAlignment;
+
+	GLRecorder::Recording recording;
+};
+
+static RecordedState s_state;
+
+// Buffer bound to a target. The element array binding belongs to the vertex array.
+static GLuint &boundBuffer(const GLenum target)
+{
+	switch(target)
+	{
+	case GL_ARRAY_BUFFER: return s_state.arrayBuffer;
+	case GL_ELEMENT_ARRAY_BUFFER: return s_state.vertexArrays[s_state.vertexArray];
+	case GL_PIXEL_PACK_BUFFER: return s_state.pixelPackBuffer;
+	case GL_PIXEL_UNPACK_BUFFER: return s_state.pixelUnpackBuffer;
+	}
+	return s_state.otherBuffer;
+}
+
+static vector<uchar> *boundBufferData(const GLenum target)
+{
+	map<GLuint, vector<uchar>>::iterator itr = s_state.buffers.find(boundBuffer(target));
+	return itr != s_state.buffers.end() ? &itr->second : nullptr;
+}
+
+static uint pixelSize(const GLenum format, const GLenum type)
+{
+	uint components = 4;
+	switch(format)
+	{
+	case GL_RED: case GL_RED_INTEGER: components = 1; break;
+	case GL_RG: case GL_RG_INTEGER: components = 2; break;
+	case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER: components = 3; break;
+	}
+	return components * (type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1 : 4);
+}
+
+// Writes zeros where pixels are read to, as nothing is rendered
+static void readPixels(const GLsizei width, const GLsizei height, const GLenum format, const GLenum type, void *pixels)
+{
+	const uint rowSize = width * pixelSize(format, type);
+	const uint alignedRowSize = (rowSize + s_state.packAlignment - 1) / s_state.packAlignment * s_state.packAlignment;
+	const uint size = alignedRowSize * (height - 1) + rowSize;
+	if(s_state.pixelPackBuffer)
+	{
+		vector<uchar> *data = boundBufferData(GL_PIXEL_PACK_BUFFER);
+		const size_t offset = (size_t) pixels;
+		if(data && offset + size <= data->size())
+		{
+			memset(&(*data)[offset], 0, size);
+		}
+	}
+	else if(pixels)
+	{
+		memset(pixels, 0, size);
+	}
+}
+
+static void genNames(const GLsizei n, GLuint *names)
+{
+	for(GLsizei i = 0; i < n; ++i)
+	{
+		names[i] = ++s_state.nextName;
+	}
+}
+
+static void recordDraw(const GLenum mode, const GLsizei count, const GLsizei instanceCount, const bool indexed)
+{
+	GLRecorder::DrawCall drawCall;
+	drawCall.mode = mode;
+	drawCall.count = count;
+	drawCall.instanceCount = instanceCount;
+	drawCall.indexed = indexed;
+	drawCall.program = s_state.program;
+	drawCall.framebuffer = s_state.framebuffer;
+	drawCall.texture = s_state.boundTextures[0];
+	s_state.recording.drawCalls.push_back(drawCall);
+	s_state.recording.vertexCount += count * instanceCount;
+}
+
+// Finds the uniforms declared in a shader source, as GL would report them
+static void parseUniforms(const string &source, vector<RecordedUniform> &uniforms)
+{
+	static const struct { const char *name; GLenum type; } types[] = {
+		{ "float", GL_FLOAT }, { "vec2", GL_FLOAT_VEC2 }, { "vec3", GL_FLOAT_VEC3 }, { "vec4", GL_FLOAT_VEC4 },
+		{ "int", GL_INT }, { "ivec2", GL_INT_VEC2 }, { "ivec3", GL_INT_VEC3 }, { "ivec4", GL_INT_VEC4 },
+		{ "uint", GL_UNSIGNED_INT }, { "uvec2", GL_UNSIGNED_INT_VEC2 }, { "uvec3", GL_UNSIGNED_INT_VEC3 }, { "uvec4", GL_UNSIGNED_INT_VEC4 },
+		{ "mat4", GL_FLOAT_MAT4 }, { "sampler2D", GL_SAMPLER_2D }, { "isampler2D", GL_INT_SAMPLER_2D }, { "usampler2D", GL_UNSIGNED_INT_SAMPLER_2D }
+	};
+
+	vector<string> statements = util::splitString(source, ";");
+	for(uint i = 0; i < statements.size(); ++i)
+	{
+		// Declarations start a line
+		const size_t pos = statements[i].find("uniform ");
+		if(pos == string::npos || (pos > 0 && !isspace((uchar) statements[i][pos - 1])))
+		{
+			continue;
+		}
+
+		stringstream ss(statements[i].substr(pos + 8));
+		string typeName, name;
+		ss >> typeName;
+		if(typeName == "lowp" || typeName == "mediump" || typeName == "highp")
+		{
+			ss >> typeName;
+		}
+		ss >> name;
+
+		RecordedUniform uniform;
+		uniform.type = 0;
+		uniform.size = 1;
+		for(uint j = 0; j < sizeof(types) / sizeof(types[0]); ++j)
+		{
+			if(typeName == types[j].name) uniform.type = types[j].type;
+		}
+
+		// Arrays are reported by their first element
+		const size_t bracket = name.find('[');
+		if(bracket != string::npos)
+		{
+			uniform.size = max(atoi(name.c_str() + bracket + 1), 1);
+			name = name.substr(0, bracket) + "[0]";
+		}
+		uniform.name = name;
+
+		bool declared = false;
+		for(uint j = 0; j < uniforms.size(); ++j)
+		{
+			if(uniforms[j].name == name) declared = true;
+		}
+		if(uniform.type != 0 && !declared)
+		{
+			uniforms.push_back(uniform);
+		}
+	}
+}
+
+/*********************************************************************
+**	Recorded entry points											**
+**********************************************************************/
+
+#define RECORD_CALL() (++s_state.recording.glCalls)
+
+static const GLubyte * APIENTRY recGetString(GLenum name)
+{
+	RECORD_CALL();
+	switch(name)
+	{
+	case GL_VENDOR: return (const GLubyte*) "x2D";
+	case GL_RENDERER: return (const GLubyte*) "GL recorder";
+	case GL_VERSION: return (const GLubyte*) "3.3 (headless)";
+	}
+	return (const GLubyte*) "";
+}
+
+static GLenum APIENTRY recGetError() { RECORD_CALL(); return GL_NO_ERROR; }
+
+static void APIENTRY recGetIntegerv(GLenum pname, GLint *data)
+{
+	RECORD_CALL();
+	switch(pname)
+	{
+	case GL_MAX_TEXTURE_IMAGE_UNITS: *data = 16; break;
+	case GL_MAJOR_VERSION: *data = GLRecorder::MAJOR_VERSION; break;
+	case GL_MINOR_VERSION: *data = GLRecorder::MINOR_VERSION; break;
+	default: *data = 0; break;
+	}
+}
+
+static void APIENTRY recEnable(GLenum) { RECORD_CALL(); ++s_state.recording.capabilityChanges; }
+static void APIENTRY recDisable(GLenum) { RECORD_CALL(); ++s_state.recording.capabilityChanges; }
+static void APIENTRY recBlendFuncSeparate(GLenum, GLenum, GLenum, GLenum) { RECORD_CALL(); ++s_state.recording.blendFuncChanges; }
+static void APIENTRY recViewport(GLint, GLint, GLsizei, GLsizei) { RECORD_CALL(); }
+static void APIENTRY recPointSize(GLfloat) { RECORD_CALL(); }
+static void APIENTRY recPolygonMode(GLenum, GLenum) { RECORD_CALL(); }
+static void APIENTRY recClearColor(GLfloat, GLfloat, GLfloat, GLfloat) { RECORD_CALL(); }
+static void APIENTRY recClearDepth(GLdouble) { RECORD_CALL(); }
+static void APIENTRY recClearStencil(GLint) { RECORD_CALL(); }
+static void APIENTRY recClear(GLbitfield) { RECORD_CALL(); ++s_state.recording.clears; }
+static void APIENTRY recReadBuffer(GLenum) { RECORD_CALL(); }
+
+static void APIENTRY recPixelStorei(GLenum pname, GLint param)
+{
+	RECORD_CALL();
+	if(pname == GL_PACK_ALIGNMENT) s_state.packAlignment = max(param, 1);
+}
+
+// Buffers
+static void APIENTRY recGenBuffers(GLsizei n, GLuint *buffers)
+{
+	RECORD_CALL();
+	genNames(n, buffers);
+	for(GLsizei i = 0; i < n; ++i) s_state.buffers[buffers[i]];
+}
+
+static void APIENTRY recDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+	RECORD_CALL();
+	for(GLsizei i = 0; i < n; ++i) s_state.buffers.erase(buffers[i]);
+}
+
+static void APIENTRY recBindBuffer(GLenum target, GLuint buffer)
+{
+	RECORD_CALL();
+	++s_state.recording.bufferBinds;
+	boundBuffer(target) = buffer;
+}
+
+static void APIENTRY recBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum)
+{
+	RECORD_CALL();
+	if(vector<uchar> *buffer = boundBufferData(target))
+	{
+		buffer->assign(size, 0);
+		if(data)
+		{
+			memcpy(buffer->data(), data, size);
+			s_state.recording.bufferUploadBytes += size;
+		}
+	}
+}
+
+static void APIENTRY recBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+	RECORD_CALL();
+	vector<uchar> *buffer = boundBufferData(target);
+	if(buffer && offset + size <= (GLsizeiptr) buffer->size())
+	{
+		memcpy(buffer->data() + offset, data, size);
+		s_state.recording.bufferUploadBytes += size;
+	}
+}
+
+static void * APIENTRY recMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	RECORD_CALL();
+	vector<uchar> *buffer = boundBufferData(target);
+	if(!buffer || offset + length > (GLsizeiptr) buffer->size())
+	{
+		return nullptr;
+	}
+	if(access & GL_MAP_WRITE_BIT)
+	{
+		s_state.recording.bufferUploadBytes += length;
+	}
+	return buffer->data() + offset;
+}
+
+static GLboolean APIENTRY recUnmapBuffer(GLenum) { RECORD_CALL(); return GL_TRUE; }
+
+// Vertex arrays
+static void APIENTRY recGenVertexArrays(GLsizei n, GLuint *arrays)
+{
+	RECORD_CALL();
+	genNames(n, arrays);
+	for(GLsizei i = 0; i < n; ++i) s_state.vertexArrays[arrays[i]] = 0;
+}
+
+static void APIENTRY recDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+	RECORD_CALL();
+	for(GLsizei i = 0; i < n; ++i) s_state.vertexArrays.erase(arrays[i]);
+}
+
+static void APIENTRY recBindVertexArray(GLuint array)
+{
+	RECORD_CALL();
+	++s_state.recording.vertexArrayBinds;
+	s_state.vertexArray = array;
+}
+
+static void APIENTRY recEnableVertexAttribArray(GLuint) { RECORD_CALL(); }
+static void APIENTRY recVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) { RECORD_CALL(); }
+static void APIENTRY recVertexAttribDivisor(GLuint, GLuint) { RECORD_CALL(); }
+
+// Textures
+static void APIENTRY recGenTextures(GLsizei n, GLuint *textures)
+{
+	RECORD_CALL();
+	genNames(n, textures);
+	for(GLsizei i = 0; i < n; ++i) s_state.textures[textures[i]] = Vector2i(0, 0);
+}
+
+static void APIENTRY recDeleteTextures(GLsizei n, const GLuint *textures)
+{
+	RECORD_CALL();
+	for(GLsizei i = 0; i < n; ++i) s_state.textures.erase(textures[i]);
+}
+
+static void APIENTRY recActiveTexture(GLenum texture)
+{
+	RECORD_CALL();
+	s_state.activeTexture = min((uint) (texture - GL_TEXTURE0), 31u);
+}
+
+static void APIENTRY recBindTexture(GLenum, GLuint texture)
+{
+	RECORD_CALL();
+	++s_state.recording.textureBinds;
+	s_state.boundTextures[s_state.activeTexture] = texture;
+}
+
+static void APIENTRY recTexImage2D(GLenum, GLint level, GLint, GLsizei width, GLsizei height, GLint, GLenum format, GLenum type, const void *pixels)
+{
+	RECORD_CALL();
+	++s_state.recording.textureUploads;
+	if(level == 0)
+	{
+		s_state.textures[s_state.boundTextures[s_state.activeTexture]] = Vector2i(width, height);
+	}
+	if(pixels)
+	{
+		s_state.recording.textureUploadBytes += width * height * pixelSize(format, type);
+	}
+}
+
+static void APIENTRY recTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void*)
+{
+	RECORD_CALL();
+	++s_state.recording.textureUploads;
+	s_state.recording.textureUploadBytes += width * height * pixelSize(format, type);
+}
+
+static void APIENTRY recTexParameteri(GLenum, GLenum, GLint) { RECORD_CALL(); }
+static void APIENTRY recGenerateMipmap(GLenum) { RECORD_CALL(); }
+
+static void APIENTRY recGetTexImage(GLenum, GLint, GLenum format, GLenum type, void *pixels)
+{
+	RECORD_CALL();
+	const Vector2i size = s_state.textures[s_state.boundTextures[s_state.activeTexture]];
+	readPixels(size.x, size.y, format, type, pixels);
+}
+
+static void APIENTRY recReadPixels(GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels)
+{
+	RECORD_CALL();
+	readPixels(width, height, format, type, pixels);
+}
+
+// Framebuffers
+static void APIENTRY recGenFramebuffers(GLsizei n, GLuint *framebuffers)
+{
+	RECORD_CALL();
+	genNames(n, framebuffers);
+	s_state.framebuffers.insert(framebuffers, framebuffers + n);
+}
+
+static void APIENTRY recDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+	RECORD_CALL();
+	for(GLsizei i = 0; i < n; ++i) s_state.framebuffers.erase(framebuffers[i]);
+}
+
+static void APIENTRY recBindFramebuffer(GLenum, GLuint framebuffer)
+{
+	RECORD_CALL();
+	++s_state.recording.framebufferBinds;
+	s_state.framebuffer = framebuffer;
+}
+
+static void APIENTRY recFramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint) { RECORD_CALL(); }
+static void APIENTRY recDrawBuffers(GLsizei, const GLenum*) { RECORD_CALL(); }
+static GLenum APIENTRY recCheckFramebufferStatus(GLenum) { RECORD_CALL(); return GL_FRAMEBUFFER_COMPLETE; }
+
+// Shaders
+static GLuint APIENTRY recCreateShader(GLenum)
+{
+	RECORD_CALL();
+	const GLuint shader = ++s_state.nextName;
+	s_state.shaders[shader];
+	return shader;
+}
+
+static void APIENTRY recDeleteShader(GLuint shader) { RECORD_CALL(); s_state.shaders.erase(shader); }
+
+static void APIENTRY recShaderSource(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths)
+{
+	RECORD_CALL();
+	string &source = s_state.shaders[shader];
+	source.clear();
+	for(GLsizei i = 0; i < count; ++i)
+	{
+		source += lengths && lengths[i] >= 0 ? string(strings[i], lengths[i]) : string(strings[i]);
+	}
+}
+
+static void APIENTRY recCompileShader(GLuint) { RECORD_CALL(); }
+
+static void APIENTRY recGetShaderiv(GLuint, GLenum pname, GLint *params)
+{
+	RECORD_CALL();
+	*params = pname == GL_COMPILE_STATUS ? GL_TRUE : pname == GL_INFO_LOG_LENGTH ? 1 : 0;
+}
+
+static void APIENTRY recGetShaderInfoLog(GLuint, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+	RECORD_CALL();
+	if(length) *length = 0;
+	if(bufSize > 0) infoLog[0] = '\0';
+}
+
+static GLuint APIENTRY recCreateProgram()
+{
+	RECORD_CALL();
+	const GLuint program = ++s_state.nextName;
+	s_state.programs[program];
+	return program;
+}
+
+static void APIENTRY recAttachShader(GLuint program, GLuint shader) { RECORD_CALL(); s_state.programs[program].shaders.push_back(shader); }
+static void APIENTRY recBindAttribLocation(GLuint, GLuint, const GLchar*) { RECORD_CALL(); }
+static void APIENTRY recBindFragDataLocation(GLuint, GLuint, const GLchar*) { RECORD_CALL(); }
+
+static void APIENTRY recLinkProgram(GLuint program)
+{
+	RECORD_CALL();
+	RecordedProgram &recordedProgram = s_state.programs[program];
+	recordedProgram.uniforms.clear();
+	for(uint i = 0; i < recordedProgram.shaders.size(); ++i)
+	{
+		parseUniforms(s_state.shaders[recordedProgram.shaders[i]], recordedProgram.uniforms);
+	}
+}
+
+static void APIENTRY recGetProgramiv(GLuint program, GLenum pname, GLint *params)
+{
+	RECORD_CALL();
+	switch(pname)
+	{
+	case GL_LINK_STATUS: *params = GL_TRUE; break;
+	case GL_INFO_LOG_LENGTH: *params = 1; break;
+	case GL_ACTIVE_UNIFORMS: *params = s_state.programs[program].uniforms.size(); break;
+	default: *params = 0; break;
+	}
+}
+
+static void APIENTRY recGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+	recGetShaderInfoLog(program, bufSize, length, infoLog);
+}
+
+static void APIENTRY recGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	RECORD_CALL();
+	const RecordedUniform &uniform = s_state.programs[program].uniforms[index];
+	const GLsizei nameLength = min((GLsizei) uniform.name.size(), bufSize - 1);
+	memcpy(name, uniform.name.c_str(), nameLength);
+	name[nameLength] = '\0';
+	if(length) *length = nameLength;
+	*size = uniform.size;
+	*type = uniform.type;
+}
+
+static GLint APIENTRY recGetUniformLocation(GLuint program, const GLchar *name)
+{
+	RECORD_CALL();
+	const vector<RecordedUniform> &uniforms = s_state.programs[program].uniforms;
+	for(uint i = 0; i < uniforms.size(); ++i)
+	{
+		if(uniforms[i].name == name || uniforms[i].name == string(name) + "[0]") return i;
+	}
+	return -1;
+}
+
+static void APIENTRY recUseProgram(GLuint program)
+{
+	RECORD_CALL();
+	++s_state.recording.programChanges;
+	s_state.program = program;
+}
+
+static void APIENTRY recUniform1i(GLint, GLint) { RECORD_CALL(); }
+static void APIENTRY recUniform2i(GLint, GLint, GLint) { RECORD_CALL(); }
+static void APIENTRY recUniform3i(GLint, GLint, GLint, GLint) { RECORD_CALL(); }
+static void APIENTRY recUniform4i(GLint, GLint, GLint, GLint, GLint) { RECORD_CALL(); }
+static void APIENTRY recUniform1ui(GLint, GLuint) { RECORD_CALL(); }
+static void APIENTRY recUniform2ui(GLint, GLuint, GLuint) { RECORD_CALL(); }
+static void APIENTRY recUniform3ui(GLint, GLuint, GLuint, GLuint) { RECORD_CALL(); }
+static void APIENTRY recUniform4ui(GLint, GLuint, GLuint, GLuint, GLuint) { RECORD_CALL(); }
+static void APIENTRY recUniform1f(GLint, GLfloat) { RECORD_CALL(); }
+static void APIENTRY recUniform3f(GLint, GLfloat, GLfloat, GLfloat) { RECORD_CALL(); }
+static void APIENTRY recUniform4f(GLint, GLfloat, GLfloat, GLfloat, GLfloat) { RECORD_CALL(); }
+static void APIENTRY recUniform2fv(GLint, GLsizei, const GLfloat*) { RECORD_CALL(); }
+static void APIENTRY recUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) { RECORD_CALL(); }
+
+// Drawing
+static void APIENTRY recDrawArrays(GLenum mode, GLint, GLsizei count) { RECORD_CALL(); recordDraw(mode, count, 1, false); }
+static void APIENTRY recDrawElements(GLenum mode, GLsizei count, GLenum, const void*) { RECORD_CALL(); recordDraw(mode, count, 1, true); }
+static void APIENTRY recDrawElementsInstanced(GLenum mode, GLsizei count, GLenum, const void*, GLsizei instanceCount) { RECORD_CALL(); recordDraw(mode, count, instanceCount, true); }
+
+// Sync objects. The recorder never runs behind.
+static GLsync APIENTRY recFenceSync(GLenum, GLbitfield) { RECORD_CALL(); return (GLsync) (size_t) ++s_state.nextName; }
+static GLenum APIENTRY recClientWaitSync(GLsync, GLbitfield, GLuint64) { RECORD_CALL(); return GL_ALREADY_SIGNALED; }
+static void APIENTRY recDeleteSync(GLsync) { RECORD_CALL(); }
+
+/*********************************************************************
+**	GL recorder														**
+**********************************************************************/
+
+void GLRecorder::install()
+{
+	s_state.nextName = 0;
+	s_state.buffers.clear();
+	s_state.textures.clear();
+	s_state.shaders.clear();
+	s_state.programs.clear();
+	s_state.framebuffers.clear();
+	s_state.vertexArrays.clear();
+	s_state.vertexArrays[0] = 0;
+	s_state.arrayBuffer = s_state.pixelPackBuffer = s_state.pixelUnpackBuffer = s_state.otherBuffer = 0;
+	s_state.vertexArray = s_state.program = s_state.framebuffer = 0;
+	s_state.activeTexture = 0;
+	memset(s_state.boundTextures, 0, sizeof(s_state.boundTextures));
+	s_state.packAlignment = 4;
+	s_state.recording = Recording();
+
+	gl3wGetString = recGetString;
+	gl3wGetError = recGetError;
+	gl3wGetIntegerv = recGetIntegerv;
+	gl3wEnable = recEnable;
+	gl3wDisable = recDisable;
+	gl3wBlendFuncSeparate = recBlendFuncSeparate;
+	gl3wViewport = recViewport;
+	gl3wPointSize = recPointSize;
+	gl3wPolygonMode = recPolygonMode;
+	gl3wClearColor = recClearColor;
+	gl3wClearDepth = recClearDepth;
+	gl3wClearStencil = recClearStencil;
+	gl3wClear = recClear;
+	gl3wReadBuffer = recReadBuffer;
+	gl3wPixelStorei = recPixelStorei;
+
+	gl3wGenBuffers = recGenBuffers;
+	gl3wDeleteBuffers = recDeleteBuffers;
+	gl3wBindBuffer = recBindBuffer;
+	gl3wBufferData = recBufferData;
+	gl3wBufferSubData = recBufferSubData;
+	gl3wMapBufferRange = recMapBufferRange;
+	gl3wUnmapBuffer = recUnmapBuffer;
+
+	gl3wGenVertexArrays = recGenVertexArrays;
+	gl3wDeleteVertexArrays = recDeleteVertexArrays;
+	gl3wBindVertexArray = recBindVertexArray;
+	gl3wEnableVertexAttribArray = recEnableVertexAttribArray;
+	gl3wVertexAttribPointer = recVertexAttribPointer;
+	gl3wVertexAttribDivisor = recVertexAttribDivisor;
+
+	gl3wGenTextures = recGenTextures;
+	gl3wDeleteTextures = recDeleteTextures;
+	gl3wActiveTexture = recActiveTexture;
+	gl3wBindTexture = recBindTexture;
+	gl3wTexImage2D = recTexImage2D;
+	gl3wTexSubImage2D = recTexSubImage2D;
+	gl3wTexParameteri = recTexParameteri;
+	gl3wGenerateMipmap = recGenerateMipmap;
+	gl3wGetTexImage = recGetTexImage;
+	gl3wReadPixels = recReadPixels;
+
+	gl3wGenFramebuffers = recGenFramebuffers;
+	gl3wDeleteFramebuffers = recDeleteFramebuffers;
+	gl3wBindFramebuffer = recBindFramebuffer;
+	gl3wFramebufferTexture2D = recFramebufferTexture2D;
+	gl3wDrawBuffers = recDrawBuffers;
+	gl3wCheckFramebufferStatus = recCheckFramebufferStatus;
+
+	gl3wCreateShader = recCreateShader;
+	gl3wDeleteShader = recDeleteShader;
+	gl3wShaderSource = recShaderSource;
+	gl3wCompileShader = recCompileShader;
+	gl3wGetShaderiv = recGetShaderiv;
+	gl3wGetShaderInfoLog = recGetShaderInfoLog;
+	gl3wCreateProgram = recCreateProgram;
+	gl3wAttachShader = recAttachShader;
+	gl3wBindAttribLocation = recBindAttribLocation;
+	gl3wBindFragDataLocation = recBindFragDataLocation;
+	gl3wLinkProgram = recLinkProgram;
+	gl3wGetProgramiv = recGetProgramiv;
+	gl3wGetProgramInfoLog = recGetProgramInfoLog;
+	gl3wGetProgramBinary = nullptr;
+	gl3wGetActiveUniform = recGetActiveUniform;
+	gl3wGetUniformLocation = recGetUniformLocation;
+	gl3wUseProgram = recUseProgram;
+	gl3wUniform1i = recUniform1i;
+	gl3wUniform2i = recUniform2i;
+	gl3wUniform3i = recUniform3i;
+	gl3wUniform4i = recUniform4i;
+	gl3wUniform1ui = recUniform1ui;
+	gl3wUniform2ui = recUniform2ui;
+	gl3wUniform3ui = recUniform3ui;
+	gl3wUniform4ui = recUniform4ui;
+	gl3wUniform1f = recUniform1f;
+	gl3wUniform3f = recUniform3f;
+	gl3wUniform4f = recUniform4f;
+	gl3wUniform2fv = recUniform2fv;
+	gl3wUniformMatrix4fv = recUniformMatrix4fv;
+
+	gl3wDrawArrays = recDrawArrays;
+	gl3wDrawElements = recDrawElements;
+	gl3wDrawElementsInstanced = recDrawElementsInstanced;
+
+	gl3wFenceSync = recFenceSync;
+	gl3wClientWaitSync = recClientWaitSync;
+	gl3wDeleteSync = recDeleteSync;
+
+	s_installed = true;
+}
+
+const GLRecorder::Recording &GLRecorder::getRecording()
+{
+	return s_state.recording;
+}
+
+void GLRecorder::clearRecording()
+{
+	s_state.recording = Recording();
+}
+
+const vector<uchar> *GLRecorder::getBufferData(const GLuint buffer)
+{
+	map<GLuint, vector<uchar>>::iterator itr = s_state.buffers.find(buffer);
+	return itr != s_state.buffers.end() ? &itr->second : nullptr;
+}
+
+Vector2i GLRecorder::getTextureSize(const GLuint texture)
+{
+	map<GLuint, Vector2i>::iterator itr = s_state.textures.find(texture);
+	return itr != s_state.textures.end() ? itr->second : Vector2i(0, 0);
+}
+
+uint GLRecorder::getObjectCount()
+{
+	// The default vertex array isn't an object
+	return s_state.buffers.size() + s_state.textures.size() + s_state.shaders.size() + s_state.programs.size() +
+		(s_state.vertexArrays.size() - 1) + s_state.framebuffers.size();
+}
+
+END_XD_NAMESPACE
@@ -31,15 +31,24 @@ Vector2 QUAD_TEXCOORD[4] = {
 };
 
 VertexFormat VertexFormat::s_vct;
+VertexFormat VertexFormat::s_vcts;
 
 double Graphics::s_framesPerSecond = 0.0;
 GraphicsContext Graphics::s_graphicsContext;
 ShaderPtr Graphics::s_defaultShader = 0;
 Texture2DPtr Graphics::s_defaultTexture = 0;
 GLuint Graphics::s_vao = 0;
-GLuint Graphics::s_vbo = 0;
-GLuint Graphics::s_ibo = 0;
+StreamBuffer *Graphics::s_vertexStream = nullptr;
+StreamBuffer *Graphics::s_indexStream = nullptr;
+FrameCapture *Graphics::s_frameCapture = nullptr;
+RenderTargetPool *Graphics::s_renderTargetPool = nullptr;
 int Graphics::s_vsync = 0;
+uint Graphics::s_textureSlotCount = 1;
+bool Graphics::s_instancingSupported = false;
+ShaderPtr Graphics::s_instancedSpriteShader = 0;
+GLuint Graphics::s_quadVbo = 0;
+GLuint Graphics::s_quadIbo = 0;
+GLuint Graphics::s_instanceVbo = 0;
 
 double Graphics::getFPS()
 {
@@ -49,7 +58,11 @@ double Graphics::getFPS()
 void Graphics::init()
 {
 	// Initialize the GLFW library
-	if(gl3wInit() != 0) {
+	if(Engine::isEnabled(XD_HEADLESS))
+	{
+		GLRecorder::install();
+	}
+	else if(gl3wInit() != 0) {
 		assert("GLEW did not initialize!");
 	}
 	
@@ -57,14 +70,17 @@ void Graphics::init()
 	LOG("** Using GPU: %s (OpenGL %s) **", glGetString(GL_VENDOR), glGetString(GL_VERSION));
 
 	// Check OpenGL 3.1 support
-	if (!gl3wIsSupported(3, 1)) {
+	if (!isGLVersionSupported(3, 1)) {
 		assert("OpenGL 3.1 not supported\n");
 	}
 
 	// Setup default vertex format
-	VertexFormat::s_vct.set(VERTEX_POSITION, 2);
-	VertexFormat::s_vct.set(VERTEX_COLOR, 4, XD_UBYTE);
-	VertexFormat::s_vct.set(VERTEX_TEX_COORD, 2);
+	VertexFormat::s_vct = VertexLayout<Position2f, Color4ub, TexCoord2f>::getFormat();
+
+	// Setup sprite vertex format
+	typedef VertexLayout<Position2f, Color4ub, TexCoord2f, TexSlot1f> SpriteLayout;
+	static_assert(sizeof(SpriteVertex) == SpriteLayout::stride, "SpriteVertex doesn't match its vertex layout");
+	VertexFormat::s_vcts = SpriteLayout::getFormat();
 
 	// Setup viewport
 	Vector2i size = Window::getSize();
@@ -72,16 +88,20 @@ void Graphics::init()
 	Window::s_graphicsContext = &s_graphicsContext;
 
 	// Init graphics
+	// Default vertex array. Draw calls bind the vertex arrays cached by GraphicsContext.
 	glGenVertexArrays(1, &s_vao);
 	glBindVertexArray(s_vao);
-	glGenBuffers(1, &s_vbo);
-	glGenBuffers(1, &s_ibo);
+	GraphicsContext::s_defaultVertexArray.id = s_vao;
+	s_vertexStream = new StreamBuffer(GL_ARRAY_BUFFER, 8 * 1024 * 1024);
+	s_indexStream = new StreamBuffer(GL_ELEMENT_ARRAY_BUFFER, 2 * 1024 * 1024);
+	s_frameCapture = new FrameCapture();
+	s_renderTargetPool = new RenderTargetPool();
 
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
 	// Enable blend
 	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GraphicsContext::setBlendFunc(BlendState(BlendState::PRESET_ALPHA_BLEND));
 
 	// Enable alpha test // Optimization?
 	//glEnable(GL_ALPHA_TEST);
@@ -89,14 +109,22 @@ void Graphics::init()
 
 	glPointSize(4);
 
+	// Vertices select one of several textures, so sprites with different
+	// textures can be drawn together. Unused slots read as slot 0.
+	GLint textureUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+	s_textureSlotCount = min(max((uint) textureUnits, 1u), GraphicsContext::MAX_TEXTURE_SLOTS);
+
 	string vertexShader =
 		"\n"
 		"in vec2 in_Position;\n"
 		"in vec2 in_TexCoord;\n"
 		"in vec4 in_VertexColor;\n"
+		"in float in_TextureSlot;\n"
 		"\n"
 		"out vec2 v_TexCoord;\n"
 		"out vec4 v_VertexColor;\n"
+		"flat out int v_TextureSlot;\n"
 		"\n"
 		"uniform mat4 u_ModelViewProj;\n"
 		"\n"
@@ -105,24 +133,96 @@ void Graphics::init()
 		"	gl_Position = vec4(in_Position, 0.0, 1.0) * u_ModelViewProj;\n"
 		"	v_TexCoord = in_TexCoord;\n"
 		"	v_VertexColor = in_VertexColor;\n"
+		"	v_TextureSlot = int(in_TextureSlot + 0.5);\n"
 		"}\n";
 
+	// Sampler arrays can't be indexed dynamically in GLSL 1.30, so each slot is its own
+	// uniform. Gradients are taken outside the branches to keep mip selection correct.
 	string fragmentShader =
 		"\n"
 		"in vec2 v_TexCoord;\n"
 		"in vec4 v_VertexColor;\n"
+		"flat in int v_TextureSlot;\n"
 		"\n"
 		"out vec4 out_FragColor;\n"
 		"\n"
-		"uniform sampler2D u_Texture;"
+		"uniform sampler2D u_Texture;\n";
+	for(uint i = 1; i < s_textureSlotCount; i++)
+	{
+		fragmentShader += "uniform sampler2D u_Texture" + util::intToStr(i) + ";\n";
+	}
+	fragmentShader +=
 		"\n"
 		"void main()\n"
 		"{\n"
-		"	out_FragColor = texture(u_Texture, v_TexCoord) * v_VertexColor;\n"
+		"	vec2 dx = dFdx(v_TexCoord);\n"
+		"	vec2 dy = dFdy(v_TexCoord);\n"
+		"	vec4 texColor;\n";
+	for(uint i = 1; i < s_textureSlotCount; i++)
+	{
+		fragmentShader += "	" + string(i > 1 ? "else " : "") + "if(v_TextureSlot == " + util::intToStr(i) + ") texColor = textureGrad(u_Texture" + util::intToStr(i) + ", v_TexCoord, dx, dy);\n";
+	}
+	fragmentShader += string(s_textureSlotCount > 1 ? "	else " : "	") + "texColor = textureGrad(u_Texture, v_TexCoord, dx, dy);\n";
+	fragmentShader +=
+		"	out_FragColor = texColor * v_VertexColor;\n"
 		"}\n";
 
 	s_defaultShader = ShaderPtr(new Shader(vertexShader, fragmentShader));
 
+	// Instanced sprites are expanded from a unit quad in the vertex shader.
+	// Same transform as Sprite::getVertices().
+	string instancedVertexShader =
+		"\n"
+		"in vec2 in_Position;\n"
+		"in vec4 in_VertexColor;\n"
+		"in vec4 in_InstanceRect;\n"
+		"in vec4 in_InstanceTransform;\n"
+		"in float in_InstanceAngle;\n"
+		"in vec4 in_InstanceTexRect;\n"
+		"\n"
+		"out vec2 v_TexCoord;\n"
+		"out vec4 v_VertexColor;\n"
+		"flat out int v_TextureSlot;\n"
+		"\n"
+		"uniform mat4 u_ModelViewProj;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 local = (in_Position * in_InstanceRect.zw - in_InstanceTransform.xy) * in_InstanceTransform.zw;\n"
+		"	float c = cos(in_InstanceAngle);\n"
+		"	float s = sin(in_InstanceAngle);\n"
+		"	vec2 position = vec2(local.x * c - local.y * s, local.x * s + local.y * c) + in_InstanceRect.xy + in_InstanceTransform.xy;\n"
+		"	gl_Position = vec4(position, 0.0, 1.0) * u_ModelViewProj;\n"
+		"	v_TexCoord = vec2(mix(in_InstanceTexRect.x, in_InstanceTexRect.z, in_Position.x), mix(in_InstanceTexRect.w, in_InstanceTexRect.y, in_Position.y));\n"
+		"	v_VertexColor = in_VertexColor;\n"
+		"	v_TextureSlot = 0;\n"
+		"}\n";
+
+	s_instancingSupported = isGLVersionSupported(3, 3);
+	if(s_instancingSupported)
+	{
+		s_instancedSpriteShader = ShaderPtr(new Shader(instancedVertexShader, fragmentShader));
+
+		const float quadVertices[8] = {
+			QUAD_VERTICES[0].x, QUAD_VERTICES[0].y,
+			QUAD_VERTICES[1].x, QUAD_VERTICES[1].y,
+			QUAD_VERTICES[2].x, QUAD_VERTICES[2].y,
+			QUAD_VERTICES[3].x, QUAD_VERTICES[3].y
+		};
+
+		glGenBuffers(1, &s_quadVbo);
+		GraphicsContext::bindBuffer(GL_ARRAY_BUFFER, s_quadVbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+		glGenBuffers(1, &s_quadIbo);
+		GraphicsContext::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_quadIbo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(QUAD_INDICES), QUAD_INDICES, GL_STATIC_DRAW);
+		glGenBuffers(1, &s_instanceVbo);
+	}
+	else
+	{
+		LOG("OpenGL 3.3 not supported. Instanced sprites will be drawn without instancing.");
+	}
+
 	uchar pixel[4];
 	pixel[0] = pixel[1] = pixel[2] = pixel[3] = 255;
 	s_defaultTexture = Texture2DPtr(new Texture2D(1, 1, pixel));
@@ -130,20 +230,46 @@ void Graphics::init()
 
 void Graphics::clear()
 {
-	glDeleteBuffers(1, &s_vbo);
+	delete s_frameCapture;
+	delete s_renderTargetPool;
+	GraphicsContext::releaseBuffer(s_quadVbo);
+	GraphicsContext::releaseBuffer(s_quadIbo);
+	GraphicsContext::releaseBuffer(s_instanceVbo);
+	glDeleteBuffers(1, &s_quadVbo);
+	glDeleteBuffers(1, &s_quadIbo);
+	glDeleteBuffers(1, &s_instanceVbo);
+	delete s_vertexStream;
+	delete s_indexStream;
 	glDeleteVertexArrays(1, &s_vao);
 }
 
+bool Graphics::isGLVersionSupported(const int major, const int minor)
+{
+	if(GLRecorder::isInstalled())
+	{
+		return GLRecorder::isSupported(major, minor);
+	}
+	return gl3wIsSupported(major, minor) != 0;
+}
+
 void Graphics::swapBuffers()
 {
-	glfwSwapBuffers(Window::s_window);
+	s_frameCapture->update();
+	if(Window::s_window)
+	{
+		glfwSwapBuffers(Window::s_window);
+	}
 	glClear(GL_COLOR_BUFFER_BIT);
+	s_vertexStream->fence();
+	s_indexStream->fence();
+	s_renderTargetPool->endFrame();
+	s_graphicsContext.endFrame();
 }
 
 // Vsync
 void Graphics::setVsync(const int mode)
 {
-	glfwSwapInterval(mode);
+	if(Window::s_window) glfwSwapInterval(mode);
 	s_vsync = mode;
 }
 
@@ -2,39 +2,101 @@
 
 BEGIN_XD_NAMESPACE
 
-GraphicsContext::GraphicsContext() :
+GraphicsContext::VertexArray GraphicsContext::s_defaultVertexArray = { 0, 0 };
+unordered_map<uint64_t, GraphicsContext::VertexArray> GraphicsContext::s_vertexArrays;
+GraphicsContext::GLState GraphicsContext::s_glState = { 0, { GL_ONE, GL_ZERO, GL_ONE, GL_ZERO }, 0, { 0 }, 0, &GraphicsContext::s_defaultVertexArray, 0, 0, 0 };
+uint GraphicsContext::s_glCallCount = 0;
+
+// Shader locations of the vertex attributes. Normals aren't used by the shaders.
+static const int ATTRIBUTE_LOCATIONS[VERTEX_ATTRIB_MAX] = {
+	VertexAttributeLocation<VERTEX_POSITION>::value,
+	VertexAttributeLocation<VERTEX_COLOR>::value,
+	VertexAttributeLocation<VERTEX_TEX_COORD>::value,
+	VertexAttributeLocation<VERTEX_NORMAL>::value,
+	VertexAttributeLocation<VERTEX_TEX_SLOT>::value
+};
+
+// Layout of the vertices of rectangles and circles
+typedef VertexLayout<Position2f, Color4ub, TexCoord2f> PrimitiveLayout;
+
+GraphicsContext::GraphicsContext(DrawList *drawList) :
 	m_width(0),
 	m_height(0),
 	m_renderTarget(nullptr),
 	m_shader(nullptr),
-	m_texture(nullptr),
-	m_blendState(BlendState::PRESET_ALPHA_BLEND)
+	m_blendState(BlendState::PRESET_ALPHA_BLEND),
+	m_modelViewMatrixDepth(0),
+	m_modelViewMatrixOverflow(0),
+	m_modelViewProjectionDirty(true),
+	m_drawList(drawList),
+	m_frameGlCallStart(0),
+	m_drawShader(nullptr),
+	m_drawBlendState(BlendState::PRESET_ALPHA_BLEND)
 {
+	for(uint i = 0; i < MAX_TEXTURE_SLOTS; ++i)
+	{
+		m_drawTextures[i] = nullptr;
+	}
 }
 
 void GraphicsContext::enable(const Capability cap)
 {
-	glEnable(cap);
+	if(m_drawList)
+	{
+		m_drawList->recordEnable(cap, true);
+		return;
+	}
+	GL_CALL(glEnable(cap));
 }
 
 void GraphicsContext::disable(const Capability cap)
 {
-	glDisable(cap);
+	if(m_drawList)
+	{
+		m_drawList->recordEnable(cap, false);
+		return;
+	}
+	GL_CALL(glDisable(cap));
 }
 
 void GraphicsContext::clear(const uint mask, const Color &fillColor)
 {
-	if(mask & COLOR_BUFFER) glClearColor(fillColor.r/255.0f, fillColor.g/255.0f, fillColor.b/255.0f, fillColor.a/255.0f);
-	if(mask & DEPTH_BUFFER) glClearDepth(fillColor.r/255.0f);
-	if(mask & STENCIL_BUFFER) glClearStencil(fillColor.r/255.0f);
-	glClear(mask);
-	if(mask & COLOR_BUFFER) glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-	if(mask & DEPTH_BUFFER) glClearDepth(0.0f);
-	if(mask & STENCIL_BUFFER) glClearStencil(0.0f);
+	if(m_drawList)
+	{
+		m_drawList->recordClear(mask, fillColor);
+		return;
+	}
+
+	if(mask & COLOR_BUFFER) GL_CALL(glClearColor(fillColor.r/255.0f, fillColor.g/255.0f, fillColor.b/255.0f, fillColor.a/255.0f));
+	if(mask & DEPTH_BUFFER) GL_CALL(glClearDepth(fillColor.r/255.0f));
+	if(mask & STENCIL_BUFFER) GL_CALL(glClearStencil(fillColor.r/255.0f));
+	GL_CALL(glClear(mask));
+	if(mask & COLOR_BUFFER) GL_CALL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+	if(mask & DEPTH_BUFFER) GL_CALL(glClearDepth(0.0f));
+	if(mask & STENCIL_BUFFER) GL_CALL(glClearStencil(0.0f));
 }
 
 void GraphicsContext::setRenderTarget(RenderTarget2D *renderTarget)
 {
+	// Record the switch, and mirror the viewport change without touching GL
+	if(m_drawList)
+	{
+		if(m_renderTarget != renderTarget)
+		{
+			m_drawList->recordSetRenderTarget(renderTarget);
+			m_renderTarget = renderTarget;
+			if(renderTarget)
+			{
+				setProjection(renderTarget->m_width, renderTarget->m_height);
+			}
+			else
+			{
+				setProjection(m_drawList->m_width, m_drawList->m_height);
+			}
+		}
+		return;
+	}
+
 	// Setup viewport and projection
 	if(m_renderTarget != renderTarget)
 	{
@@ -59,42 +121,129 @@ void GraphicsContext::setRenderTarget(RenderTarget2D *renderTarget)
 	}
 }
 
+void GraphicsContext::switchRenderTarget(RenderTarget2D *renderTarget)
+{
+	if(m_renderTarget == renderTarget)
+	{
+		return;
+	}
+
+	uint w, h;
+	if(renderTarget)
+	{
+		w = renderTarget->m_width;
+		h = renderTarget->m_height;
+	}
+	else if(m_drawList)
+	{
+		w = m_drawList->m_width;
+		h = m_drawList->m_height;
+	}
+	else
+	{
+		w = Window::getSize().x;
+		h = Window::getSize().y;
+	}
+
+	if(m_drawList)
+	{
+		m_drawList->recordSwitchRenderTarget(renderTarget);
+	}
+	else if(renderTarget)
+	{
+		renderTarget->bind();
+	}
+	else
+	{
+		m_renderTarget->unbind();
+	}
+	m_renderTarget = renderTarget;
+
+	if(m_width != w || m_height != h)
+	{
+		updateProjection(w, h);
+	}
+
+	if(!m_drawList)
+	{
+		setViewport(w, h);
+	}
+}
+
 void GraphicsContext::setModelViewMatrix(const Matrix4 &projmat)
 {
-	while(!m_modelViewMatrixStack.empty()) m_modelViewMatrixStack.pop();
-	m_modelViewMatrixStack.push(projmat);
+	if(m_drawList) m_drawList->recordSetModelViewMatrix(projmat);
+	m_modelViewMatrixStack[1] = projmat;
+	m_modelViewMatrixDepth = 1;
+	m_modelViewMatrixOverflow = 0;
+	m_modelViewProjectionDirty = true;
 }
 
 Matrix4 GraphicsContext::getModelViewMatrix() const
 {
-	if(m_modelViewMatrixStack.empty()) return Matrix4();
-	return m_modelViewMatrixStack.top();
+	return m_modelViewMatrixStack[m_modelViewMatrixDepth];
 }
 
 void GraphicsContext::pushMatrix(const Matrix4 &mat)
 {
-	if(m_modelViewMatrixStack.empty()) m_modelViewMatrixStack.push(mat);
-	else m_modelViewMatrixStack.push(m_modelViewMatrixStack.top() * mat);
+	if(m_modelViewMatrixDepth == MAX_MATRIX_STACK_DEPTH)
+	{
+		// Drop the matrix, and the pop that matches it
+		LOG("GraphicsContext::pushMatrix(): Matrix stack overflow");
+		++m_modelViewMatrixOverflow;
+		return;
+	}
+
+	if(m_drawList) m_drawList->recordPushMatrix(mat);
+	m_modelViewMatrixStack[m_modelViewMatrixDepth + 1] = m_modelViewMatrixStack[m_modelViewMatrixDepth] * mat;
+	++m_modelViewMatrixDepth;
+	m_modelViewProjectionDirty = true;
 }
 
 void GraphicsContext::popMatrix()
 {
-	if(m_modelViewMatrixStack.empty()) return;
-	m_modelViewMatrixStack.pop();
+	if(m_modelViewMatrixOverflow > 0)
+	{
+		--m_modelViewMatrixOverflow;
+		return;
+	}
+
+	if(m_modelViewMatrixDepth == 0) return;
+	if(m_drawList) m_drawList->recordPopMatrix();
+	--m_modelViewMatrixDepth;
+	m_modelViewProjectionDirty = true;
 }
 
 void GraphicsContext::setTexture(const Texture2DPtr texture)
 {
-	m_texture = texture;
+	if(m_drawList) m_drawList->recordSetTexture(0, texture);
+	m_textures[0] = texture;
 }
 
 Texture2DPtr GraphicsContext::getTexture() const
 {
-	return m_texture;
+	return m_textures[0];
+}
+
+void GraphicsContext::setTexture(const uint slot, const Texture2DPtr texture)
+{
+	if(slot >= MAX_TEXTURE_SLOTS)
+	{
+		LOG("GraphicsContext::setTexture(): Texture slot %i out of range", slot);
+		return;
+	}
+	if(m_drawList) m_drawList->recordSetTexture(slot, texture);
+	m_textures[slot] = texture;
+}
+
+Texture2DPtr GraphicsContext::getTexture(const uint slot) const
+{
+	return slot < MAX_TEXTURE_SLOTS ? m_textures[slot] : nullptr;
 }
 
 void GraphicsContext::setShader(const ShaderPtr shader)
 {
+	if(m_drawList) m_drawList->recordSetShader(shader);
 	m_shader = shader;
 }
 
@@ -105,6 +254,7 @@ ShaderPtr GraphicsContext::getShader() const
 
 void GraphicsContext::setBlendState(const BlendState &blendState)
 {
+	if(m_drawList) m_drawList->recordSetBlendState(blendState);
 	m_blendState = blendState;
 }
 
@@ -113,24 +263,233 @@ BlendState GraphicsContext::getBlendState()
 	return m_blendState;
 }
 
-#include <freeimage.h>
+GraphicsContext::Stats GraphicsContext::getStats() const
+{
+	Stats stats = m_stats;
+	if(!m_drawList)
+	{
+		stats.glCalls = s_glCallCount - m_frameGlCallStart;
+	}
+	return stats;
+}
+
+void GraphicsContext::endFrame()
+{
+	m_frameStats = getStats();
+	m_stats = Stats();
+	m_frameGlCallStart = s_glCallCount;
+}
+
+void GraphicsContext::useProgram(const GLuint program)
+{
+	if(s_glState.program != program)
+	{
+		GL_CALL(glUseProgram(program));
+		s_glState.program = program;
+	}
+}
+
+void GraphicsContext::setBlendFunc(const BlendState &blendState)
+{
+	const GLenum blendFunc[4] = { (GLenum) blendState.m_src, (GLenum) blendState.m_dst, (GLenum) blendState.m_alphaSrc, (GLenum) blendState.m_alphaDst };
+	if(memcmp(s_glState.blendFunc, blendFunc, sizeof(blendFunc)) != 0)
+	{
+		GL_CALL(glBlendFuncSeparate(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]));
+		memcpy(s_glState.blendFunc, blendFunc, sizeof(blendFunc));
+	}
+}
+
+void GraphicsContext::bindTexture(const uint unit, const GLuint texture)
+{
+	if(unit < MAX_TEXTURE_UNITS && s_glState.textures[unit] == texture)
+	{
+		return;
+	}
+
+	if(s_glState.activeTextureUnit != unit)
+	{
+		GL_CALL(glActiveTexture(GL_TEXTURE0 + unit));
+		s_glState.activeTextureUnit = unit;
+	}
+	GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+	if(unit < MAX_TEXTURE_UNITS)
+	{
+		s_glState.textures[unit] = texture;
+	}
+}
+
+void GraphicsContext::bindTexture(const GLuint texture)
+{
+	bindTexture(s_glState.activeTextureUnit, texture);
+}
+
+void GraphicsContext::bindBuffer(const GLenum target, const GLuint buffer)
+{
+	GLuint *current = target == GL_ARRAY_BUFFER ? &s_glState.arrayBuffer : (target == GL_ELEMENT_ARRAY_BUFFER ? &s_glState.vertexArray->elementArrayBuffer : nullptr);
+	if(current && *current == buffer)
+	{
+		return;
+	}
+
+	GL_CALL(glBindBuffer(target, buffer));
+	if(current)
+	{
+		*current = buffer;
+	}
+}
+
+void GraphicsContext::bindVertexArray(VertexArray *vertexArray)
+{
+	if(s_glState.vertexArray != vertexArray)
+	{
+		GL_CALL(glBindVertexArray(vertexArray->id));
+		s_glState.vertexArray = vertexArray;
+	}
+}
+
+void GraphicsContext::bindFramebuffer(const GLuint framebuffer)
+{
+	if(s_glState.framebuffer != framebuffer)
+	{
+		GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+		s_glState.framebuffer = framebuffer;
+	}
+}
+
+void GraphicsContext::setViewport(const uint w, const uint h)
+{
+	if(s_glState.viewportWidth != w || s_glState.viewportHeight != h)
+	{
+		GL_CALL(glViewport(0, 0, w, h));
+		s_glState.viewportWidth = w;
+		s_glState.viewportHeight = h;
+	}
+}
+
+bool GraphicsContext::bindVertexArray(const uint formatHash, const GLuint buffer)
+{
+	const uint64_t key = ((uint64_t) formatHash << 32) | buffer;
+	unordered_map<uint64_t, VertexArray>::iterator itr = s_vertexArrays.find(key);
+	if(itr != s_vertexArrays.end())
+	{
+		bindVertexArray(&itr->second);
+		return false;
+	}
+
+	VertexArray &vertexArray = s_vertexArrays[key];
+	GL_CALL(glGenVertexArrays(1, &vertexArray.id));
+	vertexArray.elementArrayBuffer = 0;
+	bindVertexArray(&vertexArray);
+	return true;
+}
+
+void GraphicsContext::bindVertexFormat(const VertexFormat &fmt, const GLuint buffer)
+{
+	if(!bindVertexArray(fmt.getHash(), buffer))
+	{
+		return;
+	}
+
+	// Set array pointers. Attributes of new vertex arrays start out disabled.
+	bindBuffer(GL_ARRAY_BUFFER, buffer);
+	const int stride = fmt.getVertexSizeInBytes();
+	for(int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+	{
+		const VertexAttribute attrib = VertexAttribute(i);
+		if(fmt.isAttributeEnabled(attrib) && ATTRIBUTE_LOCATIONS[i] >= 0)
+		{
+			const GLboolean normalized = attrib == VERTEX_COLOR ? GL_TRUE : GL_FALSE;
+			GL_CALL(glEnableVertexAttribArray(ATTRIBUTE_LOCATIONS[i]));
+			GL_CALL(glVertexAttribPointer(ATTRIBUTE_LOCATIONS[i], fmt.getElementCount(attrib), fmt.getDataType(attrib), normalized, stride, (void*)(size_t) fmt.getAttributeOffset(attrib)));
+		}
+	}
+}
+
+void GraphicsContext::releaseTexture(const GLuint texture)
+{
+	for(uint i = 0; i < MAX_TEXTURE_UNITS; ++i)
+	{
+		if(s_glState.textures[i] == texture)
+		{
+			s_glState.textures[i] = 0;
+		}
+	}
+}
+
+void GraphicsContext::releaseBuffer(const GLuint buffer)
+{
+	if(s_glState.arrayBuffer == buffer) s_glState.arrayBuffer = 0;
+	if(s_defaultVertexArray.elementArrayBuffer == buffer) s_defaultVertexArray.elementArrayBuffer = 0;
+
+	unordered_map<uint64_t, VertexArray>::iterator itr = s_vertexArrays.begin();
+	while(itr != s_vertexArrays.end())
+	{
+		if((GLuint) itr->first == buffer)
+		{
+			if(s_glState.vertexArray == &itr->second)
+			{
+				bindVertexArray(&s_defaultVertexArray);
+			}
+			GL_CALL(glDeleteVertexArrays(1, &itr->second.id));
+			itr = s_vertexArrays.erase(itr);
+			continue;
+		}
+
+		if(itr->second.elementArrayBuffer == buffer)
+		{
+			itr->second.elementArrayBuffer = 0;
+		}
+		++itr;
+	}
+}
+
+void GraphicsContext::releaseFramebuffer(const GLuint framebuffer)
+{
+	if(s_glState.framebuffer == framebuffer)
+	{
+		s_glState.framebuffer = 0;
+	}
+}
+
 void GraphicsContext::saveScreenshot(string path)
 {
-	// Get frame buffer data
-	uchar *data = new uchar[m_width*m_height*3];
-	glReadBuffer(GL_FRONT);
-	glReadPixels(0, 0, m_width, m_height, GL_BGR, GL_UNSIGNED_BYTE, data);
-	glReadBuffer(GL_BACK);
+	if(m_drawList)
+	{
+		LOG("GraphicsContext::saveScreenshot(): Can't be recorded in a draw list");
+		return;
+	}
+
+	Graphics::getFrameCapture().saveScreenshot(path);
+}
+
+void GraphicsContext::resizeViewport(const uint w, const uint h)
+{
+	if(m_drawList)
+	{
+		m_drawList->recordResizeViewport(w, h);
+		setProjection(w, h);
+		return;
+	}
 
-	FIBITMAP *bitmap = FreeImage_ConvertFromRawBits(data, m_width, m_height, m_width * 3, 24, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, false);
-	util::toAbsoluteFilePath(path);
-	FreeImage_Save(FIF_PNG, bitmap, path.c_str(), PNG_DEFAULT); // For now, let's just save everything as png
+	setProjection(w, h);
 
-	delete[] data;
+	// Set viewport
+	setViewport(m_width, m_height);
 }
 
 // Orthographic projection
-void GraphicsContext::resizeViewport(const uint w, const uint h)
+void GraphicsContext::setProjection(const uint w, const uint h)
+{
+	updateProjection(w, h);
+
+	// Set model-view to identity
+	m_modelViewMatrixStack[1] = Matrix4();
+	m_modelViewMatrixDepth = 1;
+	m_modelViewMatrixOverflow = 0;
+	m_modelViewProjectionDirty = true;
+}
+
+void GraphicsContext::updateProjection(const uint w, const uint h)
 {
 	// Set size
 	m_width = w;
@@ -152,366 +511,410 @@ void GraphicsContext::resizeViewport(const uint w, const uint h)
 	};
 
 	m_projectionMatrix.set(projMat);
-
-	// Set model-view to identity
-	setModelViewMatrix(Matrix4());
-	
-	// Set viewport
-	glViewport(0, 0, m_width, m_height);
+	m_modelViewProjectionDirty = true;
 }
 
 void GraphicsContext::setupContext()
+{
+	setupContext(Graphics::s_defaultShader);
+}
+
+void GraphicsContext::setupContext(const ShaderPtr defaultShader)
 {
 	// Set blend func
-	glBlendFuncSeparate(m_blendState.m_src, m_blendState.m_dst, m_blendState.m_alphaSrc, m_blendState.m_alphaDst);
+	setBlendFunc(m_blendState);
+
+	// Count state changes since the last draw call
+	if(m_blendState.m_src != m_drawBlendState.m_src || m_blendState.m_dst != m_drawBlendState.m_dst ||
+		m_blendState.m_alphaSrc != m_drawBlendState.m_alphaSrc || m_blendState.m_alphaDst != m_drawBlendState.m_alphaDst)
+	{
+		m_drawBlendState = m_blendState;
+		++m_stats.blendStateChanges;
+	}
+
+	for(uint i = 0; i < Graphics::s_textureSlotCount; ++i)
+	{
+		if(m_textures[i].get() != m_drawTextures[i])
+		{
+			m_drawTextures[i] = m_textures[i].get();
+			++m_stats.textureChanges;
+		}
+	}
 
 	ShaderPtr shader = m_shader;
 	if (!shader)
 	{
-		shader = Graphics::s_defaultShader;
-		shader->setSampler2D("u_Texture", m_texture == 0 ? Graphics::s_defaultTexture : m_texture);
+		shader = defaultShader;
+		// Texture slots of the default shaders
+		static const string TEXTURE_SLOT_UNIFORMS[MAX_TEXTURE_SLOTS] = {
+			"u_Texture", "u_Texture1", "u_Texture2", "u_Texture3",
+			"u_Texture4", "u_Texture5", "u_Texture6", "u_Texture7"
+		};
+		for(uint i = 0; i < Graphics::s_textureSlotCount; ++i)
+		{
+			shader->setSampler2D(TEXTURE_SLOT_UNIFORMS[i], m_textures[i] == 0 ? Graphics::s_defaultTexture : m_textures[i]);
+		}
 	}
 
 	// Enable shader
-	glUseProgram(shader->m_id);
+	useProgram(shader->m_id);
+	if(shader.get() != m_drawShader)
+	{
+		m_drawShader = shader.get();
+		++m_stats.shaderChanges;
+	}
 
 	// Set projection matrix
-	Matrix4 modelViewProjection = m_projectionMatrix * m_modelViewMatrixStack.top();
-	shader->setUniformMatrix4f("u_ModelViewProj", modelViewProjection.get());
+	if(m_modelViewProjectionDirty)
+	{
+		m_modelViewProjectionMatrix = m_projectionMatrix * m_modelViewMatrixStack[m_modelViewMatrixDepth];
+		m_modelViewProjectionDirty = false;
+	}
+	shader->setUniformMatrix4f("u_ModelViewProj", m_modelViewProjectionMatrix.get());
 
 	GLuint target = 0;
 
-	// Set all uniforms
+	// Upload the uniforms changed since the program last used them. Uniform
+	// values are kept by the program, but the textures bound to the units aren't.
 	for(map<string, Shader::Uniform*>::iterator itr = shader->m_uniforms.begin(); itr != shader->m_uniforms.end(); ++itr)
 	{
-		const Shader::Uniform *uniform = itr->second;
+		Shader::Uniform *uniform = itr->second;
+		const bool dirty = uniform->dirty;
+		const bool isSampler = uniform->type == GL_SAMPLER_2D || uniform->type == GL_INT_SAMPLER_2D || uniform->type == GL_UNSIGNED_INT_SAMPLER_2D;
+		if(!dirty && !isSampler)
+		{
+			continue;
+		}
+		uniform->dirty = false;
+
 		switch(uniform->type)
 		{
-		case GL_INT: glUniform1i(uniform->loc, ((GLint*)uniform->data)[0]); break;
-		case GL_INT_VEC2: glUniform2i(uniform->loc, ((GLint*)uniform->data)[0], ((GLint*)uniform->data)[1]); break;
-		case GL_INT_VEC3: glUniform3i(uniform->loc, ((GLint*)uniform->data)[0], ((GLint*)uniform->data)[1], ((GLint*)uniform->data)[2]); break;
-		case GL_INT_VEC4: glUniform4i(uniform->loc, ((GLint*)uniform->data)[0], ((GLint*)uniform->data)[1], ((GLint*)uniform->data)[2], ((GLint*)uniform->data)[3]); break;
+		case GL_INT: GL_CALL(glUniform1i(uniform->loc, ((GLint*)uniform->data)[0])); break;
+		case GL_INT_VEC2: GL_CALL(glUniform2i(uniform->loc, ((GLint*)uniform->data)[0], ((GLint*)uniform->data)[1])); break;
+		case GL_INT_VEC3: GL_CALL(glUniform3i(uniform->loc, ((GLint*)uniform->data)[0], ((GLint*)uniform->data)[1], ((GLint*)uniform->data)[2])); break;
+		case GL_INT_VEC4: GL_CALL(glUniform4i(uniform->loc, ((GLint*)uniform->data)[0], ((GLint*)uniform->data)[1], ((GLint*)uniform->data)[2], ((GLint*)uniform->data)[3])); break;
 
-		case GL_UNSIGNED_INT: glUniform1ui(uniform->loc, ((GLuint*) uniform->data)[0]); break;
-		case GL_UNSIGNED_INT_VEC2: glUniform2ui(uniform->loc, ((GLuint*) uniform->data)[0], ((GLuint*) uniform->data)[1]); break;
-		case GL_UNSIGNED_INT_VEC3: glUniform3ui(uniform->loc, ((GLuint*) uniform->data)[0], ((GLuint*) uniform->data)[1], ((GLuint*) uniform->data)[2]); break;
-		case GL_UNSIGNED_INT_VEC4: glUniform4ui(uniform->loc, ((GLuint*) uniform->data)[0], ((GLuint*) uniform->data)[1], ((GLuint*) uniform->data)[2], ((GLuint*) uniform->data)[3]); break;
+		case GL_UNSIGNED_INT: GL_CALL(glUniform1ui(uniform->loc, ((GLuint*) uniform->data)[0])); break;
+		case GL_UNSIGNED_INT_VEC2: GL_CALL(glUniform2ui(uniform->loc, ((GLuint*) uniform->data)[0], ((GLuint*) uniform->data)[1])); break;
+		case GL_UNSIGNED_INT_VEC3: GL_CALL(glUniform3ui(uniform->loc, ((GLuint*) uniform->data)[0], ((GLuint*) uniform->data)[1], ((GLuint*) uniform->data)[2])); break;
+		case GL_UNSIGNED_INT_VEC4: GL_CALL(glUniform4ui(uniform->loc, ((GLuint*) uniform->data)[0], ((GLuint*) uniform->data)[1], ((GLuint*) uniform->data)[2], ((GLuint*) uniform->data)[3])); break;
 
-		case GL_FLOAT: glUniform1f(uniform->loc, ((GLfloat*)uniform->data)[0]); break;
-		case GL_FLOAT_VEC2: glUniform2fv(uniform->loc, uniform->count, (const GLfloat*)uniform->data); break;
-		case GL_FLOAT_VEC3: glUniform3f(uniform->loc, ((GLfloat*)uniform->data)[0], ((GLfloat*)uniform->data)[1], ((GLfloat*)uniform->data)[2]); break;
-		case GL_FLOAT_VEC4: glUniform4f(uniform->loc, ((GLfloat*)uniform->data)[0], ((GLfloat*)uniform->data)[1], ((GLfloat*)uniform->data)[2], ((GLfloat*)uniform->data)[3]); break;
+		case GL_FLOAT: GL_CALL(glUniform1f(uniform->loc, ((GLfloat*)uniform->data)[0])); break;
+		case GL_FLOAT_VEC2: GL_CALL(glUniform2fv(uniform->loc, uniform->count, (const GLfloat*)uniform->data)); break;
+		case GL_FLOAT_VEC3: GL_CALL(glUniform3f(uniform->loc, ((GLfloat*)uniform->data)[0], ((GLfloat*)uniform->data)[1], ((GLfloat*)uniform->data)[2])); break;
+		case GL_FLOAT_VEC4: GL_CALL(glUniform4f(uniform->loc, ((GLfloat*)uniform->data)[0], ((GLfloat*)uniform->data)[1], ((GLfloat*)uniform->data)[2], ((GLfloat*)uniform->data)[3])); break;
 
-		case GL_FLOAT_MAT4: glUniformMatrix4fv(uniform->loc, 1, GL_FALSE, (GLfloat*)uniform->data); break;
+		case GL_FLOAT_MAT4: GL_CALL(glUniformMatrix4fv(uniform->loc, 1, GL_FALSE, (GLfloat*)uniform->data)); break;
 
 		case GL_UNSIGNED_INT_SAMPLER_2D:
 		case GL_INT_SAMPLER_2D:
 		case GL_SAMPLER_2D:
 			{
-				glActiveTexture(GL_TEXTURE0 + target);
-				glBindTexture(GL_TEXTURE_2D, ((GLuint*)uniform->data)[0]);
-				glUniform1i(uniform->loc, target++);
+				if(dirty) GL_CALL(glUniform1i(uniform->loc, target));
+				bindTexture(target++, ((GLuint*)uniform->data)[0]);
 			}
 			break;
 		}
 	}
 }
 
+uint GraphicsContext::streamVertices(const Vertex *vertices, const uint vertexCount, const uint vertexSizeInBytes)
+{
+	// Vertices are aligned to their size, so the offset is a whole number of vertices
+	uint offset;
+	char *vertexData = (char*) Graphics::s_vertexStream->map(vertexCount * vertexSizeInBytes, vertexSizeInBytes, offset);
+	for(uint i = 0; i < vertexCount; ++i)
+	{
+		vertices[i].getData(vertexData + i * vertexSizeInBytes);
+	}
+	Graphics::s_vertexStream->unmap();
+	m_stats.vertexBytes += vertexCount * vertexSizeInBytes;
+	return offset / vertexSizeInBytes;
+}
+
+uint GraphicsContext::streamVertices(const void *vertices, const uint vertexCount, const uint vertexSizeInBytes)
+{
+	uint offset;
+	void *vertexData = Graphics::s_vertexStream->map(vertexCount * vertexSizeInBytes, vertexSizeInBytes, offset);
+	memcpy(vertexData, vertices, vertexCount * vertexSizeInBytes);
+	Graphics::s_vertexStream->unmap();
+	m_stats.vertexBytes += vertexCount * vertexSizeInBytes;
+	return offset / vertexSizeInBytes;
+}
+
+uint GraphicsContext::streamIndices(const uint *indices, const uint indexCount, const uint baseVertex)
+{
+	// The vertex arrays point at the start of the vertex stream, so the
+	// indices are offset to the vertices written for this draw
+	uint offset;
+	uint *indexData = (uint*) Graphics::s_indexStream->map(indexCount * sizeof(uint), sizeof(uint), offset);
+	for(uint i = 0; i < indexCount; ++i)
+	{
+		indexData[i] = indices[i] + baseVertex;
+	}
+	Graphics::s_indexStream->unmap();
+	m_stats.indexBytes += indexCount * sizeof(uint);
+	return offset;
+}
+
 void GraphicsContext::drawIndexedPrimitives(const PrimitiveType type, const Vertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount)
 {
+	if(m_drawList)
+	{
+		m_drawList->recordDrawIndexedPrimitives(type, vertices, vertexCount, indices, indexCount);
+		return;
+	}
+
+	if(vertexCount == 0 || indexCount == 0)
+	{
+		return;
+	}
+
 	setupContext();
 
-	// Get vertices and vertex data
+	// Write the vertex data straight into the vertex stream
 	VertexFormat fmt = vertices->getFormat();
-	int vertexSizeInBytes = fmt.getVertexSizeInBytes();
-	char *vertexData = new char[vertexCount * vertexSizeInBytes];
-	for(uint i = 0; i < vertexCount; ++i)
+	const uint vertexSizeInBytes = fmt.getVertexSizeInBytes();
+	bindVertexFormat(fmt, Graphics::s_vertexStream->getId());
+	const uint baseVertex = streamVertices(vertices, vertexCount, vertexSizeInBytes);
+	const uint indexOffset = streamIndices(indices, indexCount, baseVertex);
+
+	// Draw primitives
+	GL_CALL(glDrawElements(type, indexCount, GL_UNSIGNED_INT, (void*)(size_t) indexOffset));
+	++m_stats.drawCalls;
+
+	GL_CHECK_ERROR
+}
+
+void GraphicsContext::drawIndexedPrimitives(const PrimitiveType type, const SpriteVertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount)
+{
+	if(m_drawList)
 	{
-		vertices[i].getData(vertexData + i * vertexSizeInBytes);
+		m_drawList->recordDrawIndexedPrimitives(type, vertices, vertexCount, indices, indexCount);
+		return;
 	}
 
-	// Bind buffers
-	glBindBuffer(GL_ARRAY_BUFFER, Graphics::s_vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexSizeInBytes, vertexData, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Graphics::s_ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint), indices, GL_DYNAMIC_DRAW);
-			
-	// Set array pointers
-	for(int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+	if(vertexCount == 0 || indexCount == 0)
 	{
-		VertexAttribute attrib = VertexAttribute(i);
-		switch(attrib)
-		{
-		case VERTEX_POSITION:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(0, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, vertexSizeInBytes, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(0);
-			}
-			break;
+		return;
+	}
 
-		case VERTEX_COLOR:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(1);
-				glVertexAttribPointer(1, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_TRUE, vertexSizeInBytes, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(1);
-			}
-			break;
+	setupContext();
 
-		case VERTEX_TEX_COORD:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(2);
-				glVertexAttribPointer(2, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, vertexSizeInBytes, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(2);
-			}
-			break;
-		}
+	// The vertices are already packed, so they are copied as they are
+	bindVertexFormat(VertexFormat::s_vcts, Graphics::s_vertexStream->getId());
+	uint vertexOffset;
+	void *vertexData = Graphics::s_vertexStream->map(vertexCount * sizeof(SpriteVertex), sizeof(SpriteVertex), vertexOffset);
+	memcpy(vertexData, vertices, vertexCount * sizeof(SpriteVertex));
+	Graphics::s_vertexStream->unmap();
+	m_stats.vertexBytes += vertexCount * sizeof(SpriteVertex);
+	const uint indexOffset = streamIndices(indices, indexCount, vertexOffset / sizeof(SpriteVertex));
+
+	// Draw primitives
+	GL_CALL(glDrawElements(type, indexCount, GL_UNSIGNED_INT, (void*)(size_t) indexOffset));
+	++m_stats.drawCalls;
+
+	GL_CHECK_ERROR
+}
+
+void GraphicsContext::drawIndexedPrimitives(const PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount, const uint *indices, const uint indexCount)
+{
+	if(m_drawList)
+	{
+		m_drawList->recordDrawIndexedPrimitives(type, fmt, vertices, vertexCount, indices, indexCount);
+		return;
+	}
+
+	if(vertexCount == 0 || indexCount == 0)
+	{
+		return;
 	}
 
+	setupContext();
+
+	// The vertices are already packed, so they are copied as they are
+	bindVertexFormat(fmt, Graphics::s_vertexStream->getId());
+	const uint baseVertex = streamVertices(vertices, vertexCount, fmt.getVertexSizeInBytes());
+	const uint indexOffset = streamIndices(indices, indexCount, baseVertex);
+
 	// Draw primitives
-	glDrawElements(type, indexCount, GL_UNSIGNED_INT, 0);
+	GL_CALL(glDrawElements(type, indexCount, GL_UNSIGNED_INT, (void*)(size_t) indexOffset));
+	++m_stats.drawCalls;
+
+	GL_CHECK_ERROR
+}
 
-	// Reset vbo buffers
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void GraphicsContext::drawSpriteInstances(const SpriteInstance *instances, const uint instanceCount)
+{
+	if(m_drawList)
+	{
+		m_drawList->recordDrawSpriteInstances(instances, instanceCount);
+		return;
+	}
+
+	setupContext(Graphics::s_instancedSpriteShader);
+
+	if(bindVertexArray(SPRITE_INSTANCE_FORMAT_HASH, Graphics::s_instanceVbo))
+	{
+		const int positionLocation = VertexAttributeLocation<VERTEX_POSITION>::value, colorLocation = VertexAttributeLocation<VERTEX_COLOR>::value;
+
+		// Unit quad
+		bindBuffer(GL_ARRAY_BUFFER, Graphics::s_quadVbo);
+		GL_CALL(glEnableVertexAttribArray(positionLocation));
+		GL_CALL(glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, 0));
+
+		// Per-instance data
+		bindBuffer(GL_ARRAY_BUFFER, Graphics::s_instanceVbo);
+		GL_CALL(glEnableVertexAttribArray(colorLocation));
+		GL_CALL(glVertexAttribPointer(colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, color)));
+		GL_CALL(glEnableVertexAttribArray(INSTANCE_RECT_LOCATION));
+		GL_CALL(glVertexAttribPointer(INSTANCE_RECT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, x)));
+		GL_CALL(glEnableVertexAttribArray(INSTANCE_TRANSFORM_LOCATION));
+		GL_CALL(glVertexAttribPointer(INSTANCE_TRANSFORM_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, originX)));
+		GL_CALL(glEnableVertexAttribArray(INSTANCE_ANGLE_LOCATION));
+		GL_CALL(glVertexAttribPointer(INSTANCE_ANGLE_LOCATION, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, angle)));
+		GL_CALL(glEnableVertexAttribArray(INSTANCE_TEX_RECT_LOCATION));
+		GL_CALL(glVertexAttribPointer(INSTANCE_TEX_RECT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, u0)));
+		GL_CALL(glVertexAttribDivisor(colorLocation, 1));
+		GL_CALL(glVertexAttribDivisor(INSTANCE_RECT_LOCATION, 1));
+		GL_CALL(glVertexAttribDivisor(INSTANCE_TRANSFORM_LOCATION, 1));
+		GL_CALL(glVertexAttribDivisor(INSTANCE_ANGLE_LOCATION, 1));
+		GL_CALL(glVertexAttribDivisor(INSTANCE_TEX_RECT_LOCATION, 1));
+		bindBuffer(GL_ELEMENT_ARRAY_BUFFER, Graphics::s_quadIbo);
+	}
+
+	// Upload the instances
+	bindBuffer(GL_ARRAY_BUFFER, Graphics::s_instanceVbo);
+	GL_CALL(glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(SpriteInstance), instances, GL_STREAM_DRAW));
+	m_stats.vertexBytes += instanceCount * sizeof(SpriteInstance);
+
+	// Draw instances
+	GL_CALL(glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, instanceCount));
+	++m_stats.drawCalls;
 
 	GL_CHECK_ERROR
-	
-	// Release vertex data
-	delete[] vertexData;
 }
 
 void GraphicsContext::drawIndexedPrimitives(const PrimitiveType type, const VertexBuffer *vbo, const IndexBuffer *ibo)
 {
-	setupContext();
+	drawIndexedPrimitives(type, vbo, ibo, 0, ibo->getSize());
+}
 
-	// Bind vertices and indices array
-	glBindBuffer(GL_ARRAY_BUFFER, vbo->m_id);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->m_id);
-			
-	// Set array pointers
-	VertexFormat fmt = vbo->getVertexFormat();
-	int stride = fmt.getVertexSizeInBytes();
-	for(int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+void GraphicsContext::drawIndexedPrimitives(const PrimitiveType type, const VertexBuffer *vbo, const IndexBuffer *ibo, const uint indexOffset, const uint indexCount)
+{
+	if(m_drawList)
 	{
-		VertexAttribute attrib = VertexAttribute(i);
-		switch(attrib)
-		{
-		case VERTEX_POSITION:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(0, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, stride, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(0);
-			}
-			break;
+		m_drawList->recordDrawIndexedPrimitives(type, vbo, ibo, indexOffset, indexCount);
+		return;
+	}
 
-		case VERTEX_COLOR:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(1);
-				glVertexAttribPointer(1, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_TRUE, stride, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(1);
-			}
-			break;
+	setupContext();
 
-		case VERTEX_TEX_COORD:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(2);
-				glVertexAttribPointer(2, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, stride, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(2);
-			}
-			break;
-		}
-	}
+	// Bind vertices and indices array
+	bindVertexFormat(vbo->getVertexFormat(), vbo->m_id);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->m_id);
 
 	// Draw vbo
-	glDrawElements(type, ibo->getSize(), GL_UNSIGNED_INT, 0);
-
-	// Reset vbo buffers
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GL_CALL(glDrawElements(type, indexCount, GL_UNSIGNED_INT, (void*)(indexOffset * sizeof(uint))));
+	++m_stats.drawCalls;
 
 	GL_CHECK_ERROR
 }
 
 void GraphicsContext::drawPrimitives(const PrimitiveType type, const Vertex *vertices, const uint vertexCount)
 {
+	if(m_drawList)
+	{
+		m_drawList->recordDrawPrimitives(type, vertices, vertexCount);
+		return;
+	}
+
+	if(vertexCount == 0)
+	{
+		return;
+	}
+
 	setupContext();
 
-	// Get vertices and vertex data
+	// Write the vertex data straight into the vertex stream
 	VertexFormat fmt = vertices->getFormat();
-	int vertexSizeInBytes = fmt.getVertexSizeInBytes();
-	char *vertexData = new char[vertexCount * vertexSizeInBytes];
-	for (uint i = 0; i < vertexCount; ++i)
+	const uint vertexSizeInBytes = fmt.getVertexSizeInBytes();
+	bindVertexFormat(fmt, Graphics::s_vertexStream->getId());
+	const uint baseVertex = streamVertices(vertices, vertexCount, vertexSizeInBytes);
+
+	// Draw primitives
+	GL_CALL(glDrawArrays(type, baseVertex, vertexCount));
+	++m_stats.drawCalls;
+
+	GL_CHECK_ERROR
+}
+
+void GraphicsContext::drawPrimitives(const PrimitiveType type, const VertexFormat &fmt, const void *vertices, const uint vertexCount)
+{
+	if(m_drawList)
 	{
-		vertices[i].getData(vertexData + i * vertexSizeInBytes);
+		m_drawList->recordDrawPrimitives(type, fmt, vertices, vertexCount);
+		return;
 	}
 
-	// Bind buffer
-	glBindBuffer(GL_ARRAY_BUFFER, Graphics::s_vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexSizeInBytes, vertexData, GL_DYNAMIC_DRAW);
-
-	// Set array pointers
-	for (int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+	if(vertexCount == 0)
 	{
-		VertexAttribute attrib = VertexAttribute(i);
-		switch (attrib)
-		{
-		case VERTEX_POSITION:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(0, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, vertexSizeInBytes, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(0);
-			}
-			break;
+		return;
+	}
 
-		case VERTEX_COLOR:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(1);
-				glVertexAttribPointer(1, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_TRUE, vertexSizeInBytes, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(1);
-			}
-			break;
+	setupContext();
 
-		case VERTEX_TEX_COORD:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(2);
-				glVertexAttribPointer(2, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, vertexSizeInBytes, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(2);
-			}
-			break;
-		}
-	}
+	// The vertices are already packed, so they are copied as they are
+	bindVertexFormat(fmt, Graphics::s_vertexStream->getId());
+	const uint baseVertex = streamVertices(vertices, vertexCount, fmt.getVertexSizeInBytes());
 
 	// Draw primitives
-	glDrawArrays(type, 0, vertexCount);
-
-	// Reset vbo buffers
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GL_CALL(glDrawArrays(type, baseVertex, vertexCount));
+	++m_stats.drawCalls;
 
 	GL_CHECK_ERROR
-	
-	// Release vertex data
-	delete[] vertexData;
 }
 
 void GraphicsContext::drawPrimitives(const PrimitiveType type, const VertexBuffer *vbo)
 {
-	setupContext();
-
-	// Bind vertices and indices array
-	glBindBuffer(GL_ARRAY_BUFFER, vbo->m_id);
-			
-	// Set array pointers
-	VertexFormat fmt = vbo->getVertexFormat();
-	int stride = fmt.getVertexSizeInBytes();
-	for(int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+	if(m_drawList)
 	{
-		VertexAttribute attrib = VertexAttribute(i);
-		switch(attrib)
-		{
-		case VERTEX_POSITION:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(0, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, stride, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(0);
-			}
-			break;
+		m_drawList->recordDrawPrimitives(type, vbo);
+		return;
+	}
 
-		case VERTEX_COLOR:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(1);
-				glVertexAttribPointer(1, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_TRUE, stride, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(1);
-			}
-			break;
+	setupContext();
 
-		case VERTEX_TEX_COORD:
-			if (fmt.isAttributeEnabled(attrib))
-			{
-				glEnableVertexAttribArray(2);
-				glVertexAttribPointer(2, fmt.getElementCount(attrib), fmt.getDataType(attrib), GL_FALSE, stride, (void*)fmt.getAttributeOffset(attrib));
-			}
-			else
-			{
-				glDisableVertexAttribArray(2);
-			}
-			break;
-		}
-	}
+	// Bind vertices
+	bindVertexFormat(vbo->getVertexFormat(), vbo->m_id);
 
 	// Draw vbo
-	glDrawArrays(type, 0, vbo->getSize());
-
-	// Reset vbo buffers
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GL_CALL(glDrawArrays(type, 0, vbo->getSize()));
+	++m_stats.drawCalls;
 
 	GL_CHECK_ERROR
 }
 
 void GraphicsContext::drawRectangle(const float x, const float y, const float width, const float height, const Color &color, const TextureRegion &textureRegion)
 {
-	Vertex vertices[4];
+	PrimitiveLayout::Vertex vertices[4];
 
-	vertices[0].set4f(VERTEX_POSITION, x,			y);
-	vertices[1].set4f(VERTEX_POSITION, x,			y + height);
-	vertices[2].set4f(VERTEX_POSITION, x + width,	y);
-	vertices[3].set4f(VERTEX_POSITION, x + width,	y + height);
+	vertices[0].set<Position2f>(x,			y);
+	vertices[1].set<Position2f>(x,			y + height);
+	vertices[2].set<Position2f>(x + width,	y);
+	vertices[3].set<Position2f>(x + width,	y + height);
 
-	vertices[0].set4ub(VERTEX_COLOR, color.r, color.g, color.b, color.a);
-	vertices[1].set4ub(VERTEX_COLOR, color.r, color.g, color.b, color.a);
-	vertices[2].set4ub(VERTEX_COLOR, color.r, color.g, color.b, color.a);
-	vertices[3].set4ub(VERTEX_COLOR, color.r, color.g, color.b, color.a);
-	
-	vertices[0].set4f(VERTEX_TEX_COORD, textureRegion.uv0.x, textureRegion.uv1.y);
-	vertices[1].set4f(VERTEX_TEX_COORD, textureRegion.uv0.x, textureRegion.uv0.y);
-	vertices[2].set4f(VERTEX_TEX_COORD, textureRegion.uv1.x, textureRegion.uv1.y);
-	vertices[3].set4f(VERTEX_TEX_COORD, textureRegion.uv1.x, textureRegion.uv0.y);
+	for(int i = 0; i < 4; i++)
+	{
+		vertices[i].set<Color4ub>(color.r, color.g, color.b, color.a);
+	}
 
-	drawPrimitives(PRIMITIVE_TRIANGLE_STRIP, vertices, 4);
+	vertices[0].set<TexCoord2f>(textureRegion.uv0.x, textureRegion.uv1.y);
+	vertices[1].set<TexCoord2f>(textureRegion.uv0.x, textureRegion.uv0.y);
+	vertices[2].set<TexCoord2f>(textureRegion.uv1.x, textureRegion.uv1.y);
+	vertices[3].set<TexCoord2f>(textureRegion.uv1.x, textureRegion.uv0.y);
+
+	drawPrimitives(PRIMITIVE_TRIANGLE_STRIP, PrimitiveLayout::getFormat(), vertices, 4);
 }
 
 void GraphicsContext::drawRectangle(const Vector2 &pos, const Vector2 &size, const Color &color, const TextureRegion &textureRegion)
@@ -526,23 +929,21 @@ void GraphicsContext::drawRectangle(const Rect &rect, const Color &color, const
 
 void GraphicsContext::drawCircle(const float x, const float y, const float radius, const uint segments, const Color &color)
 {
-	Vertex *vertices = new Vertex[segments+2];
+	vector<PrimitiveLayout::Vertex> vertices(segments+2);
 
-	vertices[0].set4f(xd::VERTEX_POSITION, x, y);
-	vertices[0].set4ub(xd::VERTEX_COLOR, color.r, color.g, color.b, color.a);
-	vertices[0].set4f(xd::VERTEX_TEX_COORD, 0.5f, 0.5f);
+	vertices[0].set<Position2f>(x, y);
+	vertices[0].set<Color4ub>(color.r, color.g, color.b, color.a);
+	vertices[0].set<TexCoord2f>(0.5f, 0.5f);
 
 	for(uint i = 1; i < segments+2; ++i)
 	{
 		float r = (2.0f*PI*i)/segments;
-		vertices[i].set4f(VERTEX_POSITION, x + cos(r)*radius, y + sin(r)*radius);
-		vertices[i].set4ub(VERTEX_COLOR, color.r, color.g, color.b, color.a);
-		vertices[i].set4f(VERTEX_TEX_COORD, (1 + cos(r))/2.0f, 1.0f - (1 + sin(r))/2.0f);
+		vertices[i].set<Position2f>(x + cos(r)*radius, y + sin(r)*radius);
+		vertices[i].set<Color4ub>(color.r, color.g, color.b, color.a);
+		vertices[i].set<TexCoord2f>((1 + cos(r))/2.0f, 1.0f - (1 + sin(r))/2.0f);
 	}
 
-	drawPrimitives(PRIMITIVE_TRIANGLE_FAN, vertices, segments+2);
-
-	delete[] vertices;
+	drawPrimitives(PRIMITIVE_TRIANGLE_FAN, PrimitiveLayout::getFormat(), vertices.data(), segments+2);
 }
 
 void GraphicsContext::drawCircle(const Vector2 &center, const float radius, const uint segments, const Color &color)
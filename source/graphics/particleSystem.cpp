@@ -0,0 +1,207 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define X2D_PARTICLE_SSE2
+#endif
+
+BEGIN_XD_NAMESPACE
+
+ParticleSystem::ParticleSystem(const uint capacity) :
+	m_positionX(capacity),
+	m_positionY(capacity),
+	m_velocityX(capacity),
+	m_velocityY(capacity),
+	m_life(capacity),
+	m_lifeRate(capacity),
+	m_count(0),
+	m_capacity(capacity),
+	m_startColor(255),
+	m_endColor(255),
+	m_startSize(8.0f),
+	m_endSize(8.0f),
+	m_gravityX(0.0f),
+	m_gravityY(0.0f)
+{
+}
+
+uint ParticleSystem::addEmitter(const ParticleEmitter &emitter)
+{
+	m_emitters.push_back(emitter);
+	m_emitterAccumulators.push_back(0.0f);
+	return m_emitters.size() - 1;
+}
+
+ParticleEmitter &ParticleSystem::getEmitter(const uint id)
+{
+	return m_emitters[id];
+}
+
+void ParticleSystem::removeEmitters()
+{
+	m_emitters.clear();
+	m_emitterAccumulators.clear();
+}
+
+void ParticleSystem::emit(const ParticleEmitter &emitter, const uint count)
+{
+	const uint end = min(m_count + count, m_capacity);
+	for(uint i = m_count; i < end; ++i)
+	{
+		const float speed = (float) m_random.nextDouble(emitter.minSpeed, emitter.maxSpeed);
+		const float angle = math::degToRad(emitter.direction + ((float) m_random.nextDouble() - 0.5f) * emitter.spread);
+		const float life = (float) m_random.nextDouble(emitter.minLife, emitter.maxLife);
+
+		m_positionX[i] = emitter.position.x;
+		m_positionY[i] = emitter.position.y;
+		m_velocityX[i] = cosf(angle) * speed;
+		m_velocityY[i] = sinf(angle) * speed;
+		m_life[i] = 0.0f;
+		m_lifeRate[i] = 1.0f / max(life, 0.001f);
+	}
+	m_count = end;
+}
+
+void ParticleSystem::update(const float dt)
+{
+	// Integrate velocity, position and life. Both paths evaluate the terms
+	// in the same order so they give the same results.
+	const float gravityX = m_gravityX * dt, gravityY = m_gravityY * dt;
+	uint i = 0;
+#ifdef X2D_PARTICLE_SSE2
+	const __m128 dt4 = _mm_set1_ps(dt), gravityX4 = _mm_set1_ps(gravityX), gravityY4 = _mm_set1_ps(gravityY);
+	for(; i + 4 <= m_count; i += 4)
+	{
+		const __m128 vx = _mm_add_ps(_mm_loadu_ps(m_velocityX.data() + i), gravityX4);
+		const __m128 vy = _mm_add_ps(_mm_loadu_ps(m_velocityY.data() + i), gravityY4);
+		_mm_storeu_ps(m_velocityX.data() + i, vx);
+		_mm_storeu_ps(m_velocityY.data() + i, vy);
+		_mm_storeu_ps(m_positionX.data() + i, _mm_add_ps(_mm_loadu_ps(m_positionX.data() + i), _mm_mul_ps(vx, dt4)));
+		_mm_storeu_ps(m_positionY.data() + i, _mm_add_ps(_mm_loadu_ps(m_positionY.data() + i), _mm_mul_ps(vy, dt4)));
+		_mm_storeu_ps(m_life.data() + i, _mm_add_ps(_mm_loadu_ps(m_life.data() + i), _mm_mul_ps(_mm_loadu_ps(m_lifeRate.data() + i), dt4)));
+	}
+#endif
+	for(; i < m_count; ++i)
+	{
+		m_velocityX[i] += gravityX;
+		m_velocityY[i] += gravityY;
+		m_positionX[i] += m_velocityX[i] * dt;
+		m_positionY[i] += m_velocityY[i] * dt;
+		m_life[i] += m_lifeRate[i] * dt;
+	}
+
+	// Remove dead particles by moving the last particle into their place
+	for(i = 0; i < m_count;)
+	{
+		if(m_life[i] >= 1.0f)
+		{
+			--m_count;
+			m_positionX[i] = m_positionX[m_count];
+			m_positionY[i] = m_positionY[m_count];
+			m_velocityX[i] = m_velocityX[m_count];
+			m_velocityY[i] = m_velocityY[m_count];
+			m_life[i] = m_life[m_count];
+			m_lifeRate[i] = m_lifeRate[m_count];
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	// Spawn new particles
+	for(uint j = 0; j < m_emitters.size(); ++j)
+	{
+		float &accumulator = m_emitterAccumulators[j];
+		accumulator += m_emitters[j].rate * dt;
+		const uint count = (uint) accumulator;
+		accumulator -= count;
+		emit(m_emitters[j], count);
+	}
+}
+
+void ParticleSystem::clear()
+{
+	m_count = 0;
+}
+
+void ParticleSystem::setTexture(const Texture2DPtr texture)
+{
+	m_texture = texture;
+}
+
+void ParticleSystem::setTextureRegion(const TextureRegion &textureRegion)
+{
+	m_textureRegion = textureRegion;
+}
+
+void ParticleSystem::setColor(const Color &startColor, const Color &endColor)
+{
+	m_startColor = startColor;
+	m_endColor = endColor;
+}
+
+void ParticleSystem::setSize(const float startSize, const float endSize)
+{
+	m_startSize = startSize;
+	m_endSize = endSize;
+}
+
+void ParticleSystem::setGravity(const Vector2 &gravity)
+{
+	m_gravityX = gravity.x;
+	m_gravityY = gravity.y;
+}
+
+void ParticleSystem::getVertices(SpriteVertex *vertices, uint *indices, const uint indexOffset, const uint textureSlot) const
+{
+	const float startColor[4] = { (float) m_startColor.r, (float) m_startColor.g, (float) m_startColor.b, (float) m_startColor.a };
+	const float colorDelta[4] = { m_endColor.r - startColor[0], m_endColor.g - startColor[1], m_endColor.b - startColor[2], m_endColor.a - startColor[3] };
+	const float sizeDelta = m_endSize - m_startSize;
+	const float slot = (float) textureSlot;
+	const TextureRegion &region = m_textureRegion;
+
+	for(uint i = 0; i < m_count; ++i)
+	{
+		const float t = m_life[i];
+		const float halfSize = (m_startSize + sizeDelta * t) * 0.5f;
+		const float left = m_positionX[i] - halfSize, right = m_positionX[i] + halfSize;
+		const float top = m_positionY[i] - halfSize, bottom = m_positionY[i] + halfSize;
+
+		uint color;
+		const uchar rgba[4] = {
+			(uchar) (startColor[0] + colorDelta[0] * t), (uchar) (startColor[1] + colorDelta[1] * t),
+			(uchar) (startColor[2] + colorDelta[2] * t), (uchar) (startColor[3] + colorDelta[3] * t)
+		};
+		memcpy(&color, rgba, sizeof(color));
+
+		// Same corner order and texture coordinates as sprite quads
+		SpriteVertex *quad = vertices + i * 4;
+		quad[0].x = left; quad[0].y = top; quad[0].u = region.uv0.x; quad[0].v = region.uv1.y;
+		quad[1].x = right; quad[1].y = top; quad[1].u = region.uv1.x; quad[1].v = region.uv1.y;
+		quad[2].x = right; quad[2].y = bottom; quad[2].u = region.uv1.x; quad[2].v = region.uv0.y;
+		quad[3].x = left; quad[3].y = bottom; quad[3].u = region.uv0.x; quad[3].v = region.uv0.y;
+		for(uint j = 0; j < 4; ++j)
+		{
+			quad[j].color = color;
+			quad[j].slot = slot;
+		}
+
+		for(uint j = 0; j < 6; ++j)
+		{
+			indices[i * 6 + j] = indexOffset + i * 4 + QUAD_INDICES[j];
+		}
+	}
+}
+
+END_XD_NAMESPACE
@@ -0,0 +1,315 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+BEGIN_XD_NAMESPACE
+
+PrimitiveBatch::PrimitiveBatch(GraphicsContext &graphicsContext) :
+	m_graphicsContext(graphicsContext),
+	m_beingCalled(false),
+	m_blendState(BlendState::PRESET_ALPHA_BLEND),
+	m_prevBlendState(BlendState::PRESET_ALPHA_BLEND),
+	m_primitiveCount(0),
+	m_drawCallCount(0),
+	m_autoFlushCount(0)
+{
+}
+
+void PrimitiveBatch::begin(const BlendState &blendState)
+{
+	if(m_beingCalled)
+	{
+		LOG("PrimitiveBatch::begin(): called twice before end()");
+		return;
+	}
+
+	m_beingCalled = true;
+	m_blendState = blendState;
+	m_prevBlendState = m_graphicsContext.getBlendState();
+	m_prevTexture = m_graphicsContext.getTexture();
+	m_shader = m_graphicsContext.getShader();
+	m_modelViewMatrix = m_graphicsContext.getModelViewMatrix();
+	m_vertices.clear();
+	m_indices.clear();
+	m_primitiveCount = 0;
+	m_drawCallCount = 0;
+	m_autoFlushCount = 0;
+}
+
+void PrimitiveBatch::end()
+{
+	if(!m_beingCalled)
+	{
+		LOG("PrimitiveBatch::end(): Called before begin()");
+		return;
+	}
+
+	flush();
+
+	m_graphicsContext.setBlendState(m_prevBlendState);
+	m_graphicsContext.setTexture(m_prevTexture);
+	m_prevTexture = nullptr;
+	m_shader = nullptr;
+	m_beingCalled = false;
+}
+
+void PrimitiveBatch::flush()
+{
+	if(!m_beingCalled || m_indices.empty())
+	{
+		return;
+	}
+
+	// Draw with the state the primitives were added with. The matrix is
+	// pushed relative to the current one so the context's stack is kept.
+	const ShaderPtr shader = m_graphicsContext.getShader();
+	const Matrix4 modelViewMatrix = m_graphicsContext.getModelViewMatrix();
+	const bool shaderChanged = shader != m_shader, matrixChanged = modelViewMatrix != m_modelViewMatrix;
+	if(shaderChanged)
+	{
+		m_graphicsContext.setShader(m_shader);
+	}
+	if(matrixChanged)
+	{
+		Matrix4 inverse = modelViewMatrix;
+		inverse.invert();
+		m_graphicsContext.pushMatrix(inverse * m_modelViewMatrix);
+	}
+
+	// Slot 0 without a texture samples the default white texture
+	m_graphicsContext.setBlendState(m_blendState);
+	m_graphicsContext.setTexture(nullptr);
+	m_graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_vertices.data(), m_vertices.size(), m_indices.data(), m_indices.size());
+	++m_drawCallCount;
+
+	if(matrixChanged)
+	{
+		m_graphicsContext.popMatrix();
+	}
+	if(shaderChanged)
+	{
+		m_graphicsContext.setShader(shader);
+	}
+
+	m_vertices.clear();
+	m_indices.clear();
+}
+
+void PrimitiveBatch::drawRectangle(const Rect &rect, const Color &color)
+{
+	if(!m_beingCalled)
+	{
+		LOG("PrimitiveBatch::drawRectangle(): Called before begin()");
+		return;
+	}
+
+	checkState();
+
+	const float left = rect.getLeft(), top = rect.getTop(), right = rect.getRight(), bottom = rect.getBottom();
+	addQuad(Vector2(left, top), Vector2(right, top), Vector2(right, bottom), Vector2(left, bottom), toVertexColor(color));
+	++m_primitiveCount;
+}
+
+void PrimitiveBatch::drawRectangleOutline(const Rect &rect, const Color &color, const float thickness)
+{
+	if(!m_beingCalled)
+	{
+		LOG("PrimitiveBatch::drawRectangleOutline(): Called before begin()");
+		return;
+	}
+
+	checkState();
+
+	// The edges are drawn inside the rectangle, and the side edges fit between
+	// the top and bottom edges so that the corners don't overlap
+	const float left = rect.getLeft(), top = rect.getTop(), right = rect.getRight(), bottom = rect.getBottom();
+	const float t = min(thickness, min(right - left, bottom - top) * 0.5f);
+	const uint vertexColor = toVertexColor(color);
+	addQuad(Vector2(left, top), Vector2(right, top), Vector2(right, top + t), Vector2(left, top + t), vertexColor);
+	addQuad(Vector2(left, bottom - t), Vector2(right, bottom - t), Vector2(right, bottom), Vector2(left, bottom), vertexColor);
+	addQuad(Vector2(left, top + t), Vector2(left + t, top + t), Vector2(left + t, bottom - t), Vector2(left, bottom - t), vertexColor);
+	addQuad(Vector2(right - t, top + t), Vector2(right, top + t), Vector2(right, bottom - t), Vector2(right - t, bottom - t), vertexColor);
+	++m_primitiveCount;
+}
+
+void PrimitiveBatch::drawCircle(const Vector2 &center, const float radius, const uint segments, const Color &color)
+{
+	if(!m_beingCalled)
+	{
+		LOG("PrimitiveBatch::drawCircle(): Called before begin()");
+		return;
+	}
+
+	checkState();
+
+	if(segments < 3)
+	{
+		return;
+	}
+
+	// A fan around the center vertex
+	const vector<Vector2> &table = getCircleTable(segments);
+	const uint vertexColor = toVertexColor(color);
+	const uint first = m_vertices.size();
+	addVertex(center.x, center.y, vertexColor);
+	for(uint i = 0; i < segments; ++i)
+	{
+		addVertex(center.x + table[i].x * radius, center.y + table[i].y * radius, vertexColor);
+		m_indices.push_back(first);
+		m_indices.push_back(first + 1 + i);
+		m_indices.push_back(first + 1 + (i + 1) % segments);
+	}
+	++m_primitiveCount;
+}
+
+void PrimitiveBatch::drawCircleOutline(const Vector2 &center, const float radius, const uint segments, const Color &color, const float thickness)
+{
+	if(!m_beingCalled)
+	{
+		LOG("PrimitiveBatch::drawCircleOutline(): Called before begin()");
+		return;
+	}
+
+	checkState();
+
+	if(segments < 3)
+	{
+		return;
+	}
+
+	// A ring of quads centered on the radius
+	const vector<Vector2> &table = getCircleTable(segments);
+	const uint vertexColor = toVertexColor(color);
+	const float inner = max(radius - thickness * 0.5f, 0.0f), outer = radius + thickness * 0.5f;
+	const uint first = m_vertices.size();
+	for(uint i = 0; i < segments; ++i)
+	{
+		addVertex(center.x + table[i].x * inner, center.y + table[i].y * inner, vertexColor);
+		addVertex(center.x + table[i].x * outer, center.y + table[i].y * outer, vertexColor);
+
+		const uint i0 = first + i * 2, i1 = first + ((i + 1) % segments) * 2;
+		m_indices.push_back(i0);
+		m_indices.push_back(i0 + 1);
+		m_indices.push_back(i1 + 1);
+		m_indices.push_back(i0);
+		m_indices.push_back(i1 + 1);
+		m_indices.push_back(i1);
+	}
+	++m_primitiveCount;
+}
+
+void PrimitiveBatch::drawLine(const Vector2 &p0, const Vector2 &p1, const Color &color, const float thickness)
+{
+	if(!m_beingCalled)
+	{
+		LOG("PrimitiveBatch::drawLine(): Called before begin()");
+		return;
+	}
+
+	checkState();
+
+	addLine(p0, p1, toVertexColor(color), thickness);
+	++m_primitiveCount;
+}
+
+void PrimitiveBatch::drawPolyline(const Vector2 *points, const uint pointCount, const Color &color, const float thickness, const bool closed)
+{
+	if(!m_beingCalled)
+	{
+		LOG("PrimitiveBatch::drawPolyline(): Called before begin()");
+		return;
+	}
+
+	checkState();
+
+	const uint vertexColor = toVertexColor(color);
+	for(uint i = 1; i < pointCount; ++i)
+	{
+		addLine(points[i - 1], points[i], vertexColor, thickness);
+	}
+	if(closed && pointCount > 2)
+	{
+		addLine(points[pointCount - 1], points[0], vertexColor, thickness);
+	}
+	++m_primitiveCount;
+}
+
+void PrimitiveBatch::checkState()
+{
+	const ShaderPtr shader = m_graphicsContext.getShader();
+	const Matrix4 modelViewMatrix = m_graphicsContext.getModelViewMatrix();
+	if(shader != m_shader || modelViewMatrix != m_modelViewMatrix)
+	{
+		if(!m_indices.empty())
+		{
+			++m_autoFlushCount;
+			flush();
+		}
+		m_shader = shader;
+		m_modelViewMatrix = modelViewMatrix;
+	}
+}
+
+void PrimitiveBatch::addLine(const Vector2 &p0, const Vector2 &p1, const uint color, const float thickness)
+{
+	// A quad extending half the thickness to each side of the line
+	const Vector2 delta = p1 - p0;
+	const float length = delta.magnitude();
+	if(length > 0.0f)
+	{
+		const Vector2 normal = Vector2(-delta.y, delta.x) * (thickness * 0.5f / length);
+		addQuad(p0 + normal, p1 + normal, p1 - normal, p0 - normal, color);
+	}
+}
+
+void PrimitiveBatch::addQuad(const Vector2 &p0, const Vector2 &p1, const Vector2 &p2, const Vector2 &p3, const uint color)
+{
+	const uint first = m_vertices.size();
+	addVertex(p0.x, p0.y, color);
+	addVertex(p1.x, p1.y, color);
+	addVertex(p2.x, p2.y, color);
+	addVertex(p3.x, p3.y, color);
+	for(uint i = 0; i < 6; ++i)
+	{
+		m_indices.push_back(first + QUAD_INDICES[i]);
+	}
+}
+
+void PrimitiveBatch::addVertex(const float x, const float y, const uint color)
+{
+	const SpriteVertex vertex = { x, y, color, 0.0f, 0.0f, 0.0f };
+	m_vertices.push_back(vertex);
+}
+
+const vector<Vector2> &PrimitiveBatch::getCircleTable(const uint segments)
+{
+	vector<Vector2> &table = m_circleTables[segments];
+	if(table.empty())
+	{
+		table.resize(segments);
+		for(uint i = 0; i < segments; ++i)
+		{
+			const float angle = (2.0f * PI * i) / segments;
+			table[i].set(cosf(angle), sinf(angle));
+		}
+	}
+	return table;
+}
+
+uint PrimitiveBatch::toVertexColor(const Color &color)
+{
+	const uchar rgba[4] = { color.r, color.g, color.b, color.a };
+	uint vertexColor;
+	memcpy(&vertexColor, rgba, sizeof(vertexColor));
+	return vertexColor;
+}
+
+END_XD_NAMESPACE
@@ -0,0 +1,276 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+BEGIN_XD_NAMESPACE
+
+/*********************************************************************
+**	Render target pool												**
+**********************************************************************/
+
+RenderTargetPool::RenderTargetPool()
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	clear();
+}
+
+RenderTarget2D *RenderTargetPool::acquire(const uint width, const uint height, const uint targetCount, const PixelFormat &fmt)
+{
+	// Reuse a free target with the same description
+	for(uint i = 0; i < m_entries.size(); ++i)
+	{
+		Entry &entry = m_entries[i];
+		if(!entry.acquired && entry.width == width && entry.height == height && entry.targetCount == targetCount &&
+			entry.format.getComponents() == fmt.getComponents() && entry.format.getDataType() == fmt.getDataType())
+		{
+			entry.acquired = true;
+			entry.unusedFrames = 0;
+			return entry.renderTarget;
+		}
+	}
+
+	Entry entry;
+	entry.renderTarget = new RenderTarget2D(width, height, targetCount, fmt);
+	entry.width = width;
+	entry.height = height;
+	entry.targetCount = targetCount;
+	entry.format = fmt;
+	entry.acquired = true;
+	entry.unusedFrames = 0;
+	m_entries.push_back(entry);
+	return entry.renderTarget;
+}
+
+void RenderTargetPool::release(RenderTarget2D *renderTarget)
+{
+	for(uint i = 0; i < m_entries.size(); ++i)
+	{
+		if(m_entries[i].renderTarget == renderTarget)
+		{
+			m_entries[i].acquired = false;
+			return;
+		}
+	}
+	LOG("RenderTargetPool::release(): Render target not from this pool");
+}
+
+void RenderTargetPool::endFrame(const uint frameCount)
+{
+	for(uint i = 0; i < m_entries.size();)
+	{
+		Entry &entry = m_entries[i];
+		if(!entry.acquired && ++entry.unusedFrames > frameCount)
+		{
+			delete entry.renderTarget;
+			m_entries[i] = m_entries.back();
+			m_entries.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void RenderTargetPool::clear()
+{
+	for(uint i = 0; i < m_entries.size(); ++i)
+	{
+		if(m_entries[i].acquired)
+		{
+			LOG("RenderTargetPool::clear(): Deleting a render target still in use");
+		}
+		delete m_entries[i].renderTarget;
+	}
+	m_entries.clear();
+}
+
+/*********************************************************************
+**	Render graph													**
+**********************************************************************/
+
+RenderGraph::RenderGraph(RenderTargetPool &pool) :
+	m_pool(pool),
+	m_executedPassCount(0),
+	m_targetSwitchCount(0)
+{
+}
+
+uint RenderGraph::createTarget(const uint width, const uint height, const uint targetCount, const PixelFormat &fmt)
+{
+	Resource resource;
+	resource.renderTarget = nullptr;
+	resource.imported = false;
+	resource.width = width;
+	resource.height = height;
+	resource.targetCount = targetCount;
+	resource.format = fmt;
+	m_resources.push_back(resource);
+	return m_resources.size() - 1;
+}
+
+uint RenderGraph::importTarget(RenderTarget2D *renderTarget)
+{
+	Resource resource;
+	resource.renderTarget = renderTarget;
+	resource.imported = true;
+	resource.width = renderTarget ? renderTarget->getWidth() : 0;
+	resource.height = renderTarget ? renderTarget->getHeight() : 0;
+	resource.targetCount = renderTarget ? renderTarget->getTargetCount() : 0;
+	m_resources.push_back(resource);
+	return m_resources.size() - 1;
+}
+
+uint RenderGraph::addPass(const string &name, const uint output, const PassFunc &func)
+{
+	if(output >= m_resources.size())
+	{
+		LOG("RenderGraph::addPass(): Pass '%s' writes an unknown target", name.c_str());
+	}
+
+	Pass pass;
+	pass.name = name;
+	pass.output = output;
+	pass.func = func;
+	m_passes.push_back(pass);
+	return m_passes.size() - 1;
+}
+
+void RenderGraph::addInput(const uint pass, const uint input)
+{
+	if(pass >= m_passes.size() || input >= m_resources.size())
+	{
+		LOG("RenderGraph::addInput(): Unknown pass or target");
+		return;
+	}
+	m_passes[pass].inputs.push_back(input);
+}
+
+void RenderGraph::execute(GraphicsContext &graphicsContext)
+{
+	m_executedPassCount = 0;
+	m_targetSwitchCount = 0;
+
+	// Walk the passes backwards to find the ones contributing to an imported
+	// target. Every earlier pass writing a target in use is kept, as passes
+	// may draw on top of each other.
+	const uint passCount = m_passes.size();
+	vector<bool> passUsed(passCount, false);
+	vector<bool> resourceUsed(m_resources.size(), false);
+	for(uint i = passCount; i-- > 0;)
+	{
+		const Pass &pass = m_passes[i];
+		if(pass.output >= m_resources.size() || (!m_resources[pass.output].imported && !resourceUsed[pass.output]))
+		{
+			continue;
+		}
+
+		passUsed[i] = true;
+		resourceUsed[pass.output] = true;
+		for(uint j = 0; j < pass.inputs.size(); ++j)
+		{
+			resourceUsed[pass.inputs[j]] = true;
+		}
+	}
+
+	// Find the first and last pass using each target
+	vector<uint> firstUse(m_resources.size(), passCount), lastUse(m_resources.size(), passCount);
+	for(uint i = 0; i < passCount; ++i)
+	{
+		if(!passUsed[i]) continue;
+		const Pass &pass = m_passes[i];
+		for(uint j = 0; j <= pass.inputs.size(); ++j)
+		{
+			const uint resource = j < pass.inputs.size() ? pass.inputs[j] : pass.output;
+			if(firstUse[resource] == passCount) firstUse[resource] = i;
+			lastUse[resource] = i;
+		}
+	}
+
+	RenderTarget2D *prevRenderTarget = graphicsContext.getRenderTarget();
+	for(uint i = 0; i < passCount; ++i)
+	{
+		if(!passUsed[i]) continue;
+		const Pass &pass = m_passes[i];
+
+		// Allocate the transient targets first used by this pass
+		for(uint j = 0; j <= pass.inputs.size(); ++j)
+		{
+			const uint resource = j < pass.inputs.size() ? pass.inputs[j] : pass.output;
+			Resource &res = m_resources[resource];
+			if(!res.imported && firstUse[resource] == i && !res.renderTarget)
+			{
+				if(resource != pass.output)
+				{
+					LOG("RenderGraph::execute(): Pass '%s' reads a target no pass has written", pass.name.c_str());
+				}
+				res.renderTarget = m_pool.acquire(res.width, res.height, res.targetCount, res.format);
+			}
+		}
+
+		// Consecutive passes drawing to the same target don't rebind it
+		RenderTarget2D *renderTarget = m_resources[pass.output].renderTarget;
+		if(graphicsContext.getRenderTarget() != renderTarget)
+		{
+			graphicsContext.setRenderTarget(renderTarget);
+			++m_targetSwitchCount;
+		}
+
+		pass.func(graphicsContext, *this);
+		++m_executedPassCount;
+
+		// Hand back the transient targets no later pass uses, so the
+		// following passes can alias them
+		for(uint j = 0; j <= pass.inputs.size(); ++j)
+		{
+			const uint resource = j < pass.inputs.size() ? pass.inputs[j] : pass.output;
+			Resource &res = m_resources[resource];
+			if(!res.imported && lastUse[resource] == i && res.renderTarget)
+			{
+				m_pool.release(res.renderTarget);
+				res.renderTarget = nullptr;
+			}
+		}
+	}
+
+	if(graphicsContext.getRenderTarget() != prevRenderTarget)
+	{
+		graphicsContext.setRenderTarget(prevRenderTarget);
+		++m_targetSwitchCount;
+	}
+}
+
+RenderTarget2D *RenderGraph::getTarget(const uint resource) const
+{
+	if(resource >= m_resources.size())
+	{
+		LOG("RenderGraph::getTarget(): Unknown target");
+		return nullptr;
+	}
+	return m_resources[resource].renderTarget;
+}
+
+Texture2DPtr RenderGraph::getTexture(const uint resource, const uint target) const
+{
+	RenderTarget2D *renderTarget = getTarget(resource);
+	return renderTarget ? renderTarget->getTexture(target) : nullptr;
+}
+
+void RenderGraph::clear()
+{
+	m_resources.clear();
+	m_passes.clear();
+}
+
+END_XD_NAMESPACE
@@ -28,6 +28,8 @@ RenderTarget2D::RenderTarget2D(const uint width, const uint height, const uint c
 		m_textures[i] = Texture2DPtr(new Texture2D(width, height, 0, fmt));
 		m_buffers[i] = GL_COLOR_ATTACHMENT0 + i;
 	}
+
+	attachTextures();
 }
 
 RenderTarget2D::RenderTarget2D(Texture2DPtr target) :
@@ -41,29 +43,45 @@ RenderTarget2D::RenderTarget2D(Texture2DPtr target) :
 	// Set texture variables
 	(m_textures = new Texture2DPtr[1])[0] = target;
 	(m_buffers = new GLenum[1])[0] = GL_COLOR_ATTACHMENT0;
+
+	attachTextures();
 }
 
 RenderTarget2D::~RenderTarget2D()
 {
+	GraphicsContext::releaseFramebuffer(m_id);
 	glDeleteFramebuffers(1, &m_id);
 	delete[] m_textures;
 	delete[] m_buffers;
 }
 
-void RenderTarget2D::bind()
+void RenderTarget2D::attachTextures()
 {
-	// Bind framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+	// Attachments and draw buffers are framebuffer state, so binding the
+	// framebuffer later is enough
+	const GLuint prevFramebuffer = GraphicsContext::s_glState.framebuffer;
+	GraphicsContext::bindFramebuffer(m_id);
 	for(uint i = 0; i < m_textureCount; ++i)
 	{
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_textures[i]->m_id, 0);
 	}
 	glDrawBuffers(m_textureCount, m_buffers);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG("RenderTarget2D::attachTextures(): Framebuffer is incomplete");
+	}
+	GraphicsContext::bindFramebuffer(prevFramebuffer);
+}
+
+void RenderTarget2D::bind()
+{
+	GraphicsContext::bindFramebuffer(m_id);
 }
 
 void RenderTarget2D::unbind()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GraphicsContext::bindFramebuffer(0);
 }
 
 END_XD_NAMESPACE
\ No newline at end of file
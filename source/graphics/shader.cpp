@@ -84,9 +84,14 @@ Shader::Shader(const string &vertexSource, const string &fragmentSource)
     glAttachShader(m_id, m_vertShaderID);
     glAttachShader(m_id, m_fragShaderID);
 
-	glBindAttribLocation(m_id, 0, "in_Position");
-	glBindAttribLocation(m_id, 1, "in_VertexColor");
-	glBindAttribLocation(m_id, 2, "in_TexCoord");
+	glBindAttribLocation(m_id, VertexAttributeLocation<VERTEX_POSITION>::value, "in_Position");
+	glBindAttribLocation(m_id, VertexAttributeLocation<VERTEX_COLOR>::value, "in_VertexColor");
+	glBindAttribLocation(m_id, VertexAttributeLocation<VERTEX_TEX_COORD>::value, "in_TexCoord");
+	glBindAttribLocation(m_id, INSTANCE_RECT_LOCATION, "in_InstanceRect");
+	glBindAttribLocation(m_id, INSTANCE_TRANSFORM_LOCATION, "in_InstanceTransform");
+	glBindAttribLocation(m_id, INSTANCE_ANGLE_LOCATION, "in_InstanceAngle");
+	glBindAttribLocation(m_id, INSTANCE_TEX_RECT_LOCATION, "in_InstanceTexRect");
+	glBindAttribLocation(m_id, VertexAttributeLocation<VERTEX_TEX_SLOT>::value, "in_TextureSlot");
 	glBindFragDataLocation(m_id, 0, "out_FragColor");
 
 	link();
@@ -194,6 +199,7 @@ void Shader::setUniform1i(const string &name, const int v0)
 		if(uniform->type == GL_INT)
 		{
 			((GLint*) uniform->data)[0] = v0;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -216,6 +222,7 @@ void Shader::setUniform2i(const string &name, const int v0, const int v1)
 		{
 			((GLint*) uniform->data)[0] = v0;
 			((GLint*) uniform->data)[1] = v1;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -239,6 +246,7 @@ void Shader::setUniform3i(const string &name, const int v0, const int v1, const
 			((GLint*) uniform->data)[0] = v0;
 			((GLint*) uniform->data)[1] = v1;
 			((GLint*) uniform->data)[2] = v2;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -263,6 +271,7 @@ void Shader::setUniform4i(const string &name, const int v0, const int v1, const
 			((GLint*) uniform->data)[1] = v1;
 			((GLint*) uniform->data)[2] = v2;
 			((GLint*) uniform->data)[3] = v3;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -284,6 +293,7 @@ void Shader::setUniform1ui(const string &name, const uint v0)
 		if(uniform->type == GL_UNSIGNED_INT)
 		{
 			((GLuint*) uniform->data)[0] = v0;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -306,6 +316,7 @@ void Shader::setUniform2ui(const string &name, const uint v0, const uint v1)
 		{
 			((GLuint*) uniform->data)[0] = v0;
 			((GLuint*) uniform->data)[1] = v1;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -329,6 +340,7 @@ void Shader::setUniform3ui(const string &name, const uint v0, const uint v1, con
 			((GLuint*) uniform->data)[0] = v0;
 			((GLuint*) uniform->data)[1] = v1;
 			((GLuint*) uniform->data)[2] = v2;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -353,6 +365,7 @@ void Shader::setUniform4ui(const string &name, const uint v0, const uint v1, con
 			((GLuint*) uniform->data)[1] = v1;
 			((GLuint*) uniform->data)[2] = v2;
 			((GLuint*) uniform->data)[3] = v3;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -374,6 +387,7 @@ void Shader::setUniform1f(const string &name, const float v0)
 		if(uniform->type == GL_FLOAT)
 		{
 			((GLfloat*) uniform->data)[0] = v0;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -396,6 +410,7 @@ void Shader::setUniform2f(const string &name, const float v0, const float v1)
 		{
 			((GLfloat*) uniform->data)[0] = v0;
 			((GLfloat*) uniform->data)[1] = v1;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -417,6 +432,7 @@ void Shader::setUniform2f(const string & name, const float * v)
 		if(uniform->type == GL_FLOAT_VEC2)
 		{
 			memcpy(uniform->data, v,  2 * uniform->count * FLOAT_SIZE);
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -440,6 +456,7 @@ void Shader::setUniform3f(const string &name, const float v0, const float v1, co
 			((GLfloat*) uniform->data)[0] = v0;
 			((GLfloat*) uniform->data)[1] = v1;
 			((GLfloat*) uniform->data)[2] = v2;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -464,6 +481,7 @@ void Shader::setUniform4f(const string &name, const float v0, const float v1, co
 			((GLfloat*) uniform->data)[1] = v1;
 			((GLfloat*) uniform->data)[2] = v2;
 			((GLfloat*) uniform->data)[3] = v3;
+			uniform->dirty = true;
 		}
 		else
 		{
@@ -484,9 +502,11 @@ void Shader::setUniformMatrix4f(const string & name, const float * v0)
 		Uniform *uniform = itr->second;
 		if(uniform->type == GL_FLOAT_MAT4)
 		{
-			for(int i = 0; i < 16; ++i)
+			// The model-view-projection matrix is set before every draw, but rarely changes
+			if(memcmp(uniform->data, v0, 16 * sizeof(GLfloat)) != 0)
 			{
-				((GLfloat*) uniform->data)[i] = v0[i];
+				memcpy(uniform->data, v0, 16 * sizeof(GLfloat));
+				uniform->dirty = true;
 			}
 		}
 		else
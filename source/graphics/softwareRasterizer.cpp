@@ -0,0 +1,865 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define X2D_RASTER_SSE2
+#endif
+
+BEGIN_XD_NAMESPACE
+
+/*********************************************************************
+**	Four channel colors												**
+**********************************************************************/
+// RGBA in [0, 1]. With SSE2 the channels of a pixel are blended together
+// in one register.
+#ifdef X2D_RASTER_SSE2
+struct Float4
+{
+	__m128 v;
+};
+
+static inline Float4 makeFloat4(const __m128 v) { Float4 f; f.v = v; return f; }
+static inline Float4 loadFloat4(const float *values) { return makeFloat4(_mm_loadu_ps(values)); }
+static inline Float4 splat(const float value) { return makeFloat4(_mm_set1_ps(value)); }
+static inline Float4 operator+(const Float4 &a, const Float4 &b) { return makeFloat4(_mm_add_ps(a.v, b.v)); }
+static inline Float4 operator-(const Float4 &a, const Float4 &b) { return makeFloat4(_mm_sub_ps(a.v, b.v)); }
+static inline Float4 operator*(const Float4 &a, const Float4 &b) { return makeFloat4(_mm_mul_ps(a.v, b.v)); }
+static inline Float4 operator*(const Float4 &a, const float b) { return makeFloat4(_mm_mul_ps(a.v, _mm_set1_ps(b))); }
+static inline Float4 min4(const Float4 &a, const Float4 &b) { return makeFloat4(_mm_min_ps(a.v, b.v)); }
+static inline Float4 splatAlpha(const Float4 &a) { return makeFloat4(_mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+// The color channels of rgb and the alpha channel of alpha
+static inline Float4 withAlpha(const Float4 &rgb, const Float4 &alpha)
+{
+	const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+	return makeFloat4(_mm_or_ps(_mm_andnot_ps(mask, rgb.v), _mm_and_ps(mask, alpha.v)));
+}
+
+static inline Float4 unpackColor(const uint color)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bytes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int) color), zero), zero);
+	return makeFloat4(_mm_mul_ps(_mm_cvtepi32_ps(bytes), _mm_set1_ps(1.0f / 255.0f)));
+}
+
+// Saturates to [0, 255] while packing
+static inline uint packColor(const Float4 &color)
+{
+	const __m128i ints = _mm_cvtps_epi32(_mm_mul_ps(color.v, _mm_set1_ps(255.0f)));
+	const __m128i shorts = _mm_packs_epi32(ints, ints);
+	return (uint) _mm_cvtsi128_si32(_mm_packus_epi16(shorts, shorts));
+}
+#else
+struct Float4
+{
+	float v[4];
+};
+
+static inline Float4 loadFloat4(const float *values) { Float4 f; memcpy(f.v, values, sizeof(f.v)); return f; }
+static inline Float4 splat(const float value) { Float4 f; f.v[0] = f.v[1] = f.v[2] = f.v[3] = value; return f; }
+static inline Float4 operator+(const Float4 &a, const Float4 &b) { Float4 f; for(int i = 0; i < 4; i++) f.v[i] = a.v[i] + b.v[i]; return f; }
+static inline Float4 operator-(const Float4 &a, const Float4 &b) { Float4 f; for(int i = 0; i < 4; i++) f.v[i] = a.v[i] - b.v[i]; return f; }
+static inline Float4 operator*(const Float4 &a, const Float4 &b) { Float4 f; for(int i = 0; i < 4; i++) f.v[i] = a.v[i] * b.v[i]; return f; }
+static inline Float4 operator*(const Float4 &a, const float b) { Float4 f; for(int i = 0; i < 4; i++) f.v[i] = a.v[i] * b; return f; }
+static inline Float4 min4(const Float4 &a, const Float4 &b) { Float4 f; for(int i = 0; i < 4; i++) f.v[i] = min(a.v[i], b.v[i]); return f; }
+static inline Float4 splatAlpha(const Float4 &a) { return splat(a.v[3]); }
+static inline Float4 withAlpha(const Float4 &rgb, const Float4 &alpha) { Float4 f = rgb; f.v[3] = alpha.v[3]; return f; }
+
+static inline Float4 unpackColor(const uint color)
+{
+	uchar bytes[4];
+	memcpy(bytes, &color, sizeof(bytes));
+	Float4 f;
+	for(int i = 0; i < 4; i++) f.v[i] = bytes[i] / 255.0f;
+	return f;
+}
+
+static inline uint packColor(const Float4 &color)
+{
+	uchar bytes[4];
+	for(int i = 0; i < 4; i++) bytes[i] = (uchar) (min(max(color.v[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+	uint packed;
+	memcpy(&packed, bytes, sizeof(packed));
+	return packed;
+}
+#endif
+
+// Source or destination factor of a blend function
+static inline Float4 getBlendFactor(const BlendState::BlendFactor factor, const Float4 &src, const Float4 &dst)
+{
+	switch(factor)
+	{
+	case BlendState::BLEND_ZERO: return splat(0.0f);
+	case BlendState::BLEND_SRC_COLOR: return src;
+	case BlendState::BLEND_ONE_MINUS_SRC_COLOR: return splat(1.0f) - src;
+	case BlendState::BLEND_SRC_ALPHA: return splatAlpha(src);
+	case BlendState::BLEND_ONE_MINUS_SRC_ALPHA: return splat(1.0f) - splatAlpha(src);
+	case BlendState::BLEND_DST_COLOR: return dst;
+	case BlendState::BLEND_ONE_MINUS_DST_COLOR: return splat(1.0f) - dst;
+	case BlendState::BLEND_DST_ALPHA: return splatAlpha(dst);
+	case BlendState::BLEND_MINUS_DST_ALPHA: return splat(1.0f) - splatAlpha(dst);
+	case BlendState::BLEND_ALPHA_SATURATE: return withAlpha(min4(splatAlpha(src), splat(1.0f) - splatAlpha(dst)), splat(1.0f));
+	default: return splat(1.0f);
+	}
+}
+
+// Reads a component of packed vertex data, which has no alignment guarantee
+template<typename T>
+static float readComponent(const char *data, const int index, const float scale)
+{
+	T value;
+	memcpy(&value, data + index * sizeof(T), sizeof(T));
+	return value * scale;
+}
+
+// Reads up to four components of a vertex attribute as floats
+static void readAttribute(const VertexFormat &format, const char *data, const VertexAttribute attrib, float *values)
+{
+	if(!format.isAttributeEnabled(attrib))
+	{
+		return;
+	}
+
+	const char *attribData = data + format.getAttributeOffset(attrib);
+	const bool normalized = attrib == VERTEX_COLOR;
+	for(int i = 0; i < format.getElementCount(attrib); i++)
+	{
+		switch(format.getDataType(attrib))
+		{
+		case XD_FLOAT: values[i] = readComponent<float>(attribData, i, 1.0f); break;
+		case XD_UINT: values[i] = readComponent<uint>(attribData, i, normalized ? 1.0f / 4294967295.0f : 1.0f); break;
+		case XD_INT: values[i] = readComponent<int>(attribData, i, normalized ? 1.0f / 2147483647.0f : 1.0f); break;
+		case XD_USHORT: values[i] = readComponent<ushort>(attribData, i, normalized ? 1.0f / 65535.0f : 1.0f); break;
+		case XD_SHORT: values[i] = readComponent<short>(attribData, i, normalized ? 1.0f / 32767.0f : 1.0f); break;
+		case XD_UBYTE: values[i] = readComponent<uchar>(attribData, i, normalized ? 1.0f / 255.0f : 1.0f); break;
+		case XD_BYTE: values[i] = readComponent<char>(attribData, i, normalized ? 1.0f / 127.0f : 1.0f); break;
+		}
+	}
+}
+
+// Converts packed vertex data to the layout of the default shader
+static void toSpriteVertex(const VertexFormat &format, const char *data, SpriteVertex &spriteVertex)
+{
+	float position[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, color[4] = { 1.0f, 1.0f, 1.0f, 1.0f }, texCoord[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, slot[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	readAttribute(format, data, VERTEX_POSITION, position);
+	readAttribute(format, data, VERTEX_COLOR, color);
+	readAttribute(format, data, VERTEX_TEX_COORD, texCoord);
+	readAttribute(format, data, VERTEX_TEX_SLOT, slot);
+
+	spriteVertex.x = position[0];
+	spriteVertex.y = position[1];
+	const Float4 c = loadFloat4(color);
+	spriteVertex.color = packColor(c);
+	spriteVertex.u = texCoord[0];
+	spriteVertex.v = texCoord[1];
+	spriteVertex.slot = slot[0];
+}
+
+static void toSpriteVertex(const Vertex &vertex, SpriteVertex &spriteVertex)
+{
+	char data[VERTEX_ATTRIB_MAX * 4 * sizeof(float)];
+	vertex.getData(data);
+	toSpriteVertex(vertex.getFormat(), data, spriteVertex);
+}
+
+// Pixel bounds of a triangle, clipped to its clip rectangle. Returns false if nothing is covered.
+static bool getTriangleBounds(const float *x, const float *y, const int *clipRect, int *bounds)
+{
+	bounds[0] = max(clipRect[0], (int) floor(min(x[0], min(x[1], x[2]))));
+	bounds[1] = max(clipRect[1], (int) floor(min(y[0], min(y[1], y[2]))));
+	bounds[2] = min(clipRect[2], (int) ceil(max(x[0], max(x[1], x[2]))));
+	bounds[3] = min(clipRect[3], (int) ceil(max(y[0], max(y[1], y[2]))));
+	return bounds[0] < bounds[2] && bounds[1] < bounds[3];
+}
+
+/*********************************************************************
+**	Software rasterizer												**
+**********************************************************************/
+SoftwareRasterizer::SoftwareRasterizer(const uint width, const uint height) :
+	m_surface(nullptr),
+	m_viewportWidth(width),
+	m_viewportHeight(height),
+	m_projectionWidth(width),
+	m_projectionHeight(height),
+	m_blendState(BlendState::PRESET_ALPHA_BLEND),
+	m_blend(true),
+	m_scissorTest(false),
+	m_scissor(0, 0, INT_MAX, INT_MAX),
+	m_triangleCount(0)
+{
+	m_screen.width = width;
+	m_screen.height = height;
+	m_screen.pixels.resize(width * height, 0);
+
+	m_whiteTexture.width = m_whiteTexture.height = 1;
+	m_whiteTexture.pixels.push_back(0xFFFFFFFF);
+
+	for(uint i = 0; i < GraphicsContext::MAX_TEXTURE_SLOTS; i++)
+	{
+		m_drawTextures[i] = nullptr;
+	}
+}
+
+void SoftwareRasterizer::render(const DrawList &drawList)
+{
+	// Start from the state the engine sets up for the screen
+	m_surface = &m_screen;
+	m_viewportWidth = m_screen.width;
+	m_viewportHeight = m_screen.height;
+	m_projectionWidth = drawList.m_width;
+	m_projectionHeight = drawList.m_height;
+	m_matrixStack.assign(2, Matrix4());
+	for(uint i = 0; i < GraphicsContext::MAX_TEXTURE_SLOTS; i++)
+	{
+		m_textures[i] = nullptr;
+	}
+	m_blendState = BlendState(BlendState::PRESET_ALPHA_BLEND);
+	m_blend = true;
+	m_scissorTest = false;
+	m_triangleCount = 0;
+
+	RenderTarget2D *renderTarget = nullptr;
+	bool skippedBufferDraws = false;
+	const uchar *data = drawList.m_data.data(), *end = data + drawList.m_data.size();
+	while(data < end)
+	{
+		const DrawList::Command command = (DrawList::Command) DrawList::read<uchar>(data);
+		switch(command)
+		{
+		case DrawList::CMD_ENABLE:
+		case DrawList::CMD_DISABLE:
+			{
+				const GraphicsContext::Capability cap = DrawList::read<GraphicsContext::Capability>(data);
+				const bool enable = command == DrawList::CMD_ENABLE;
+				if(cap == GraphicsContext::BLEND)
+				{
+					m_blend = enable;
+				}
+				else if(cap == GraphicsContext::SCISSOR_TEST)
+				{
+					m_scissorTest = enable;
+				}
+			}
+			break;
+
+		case DrawList::CMD_CLEAR:
+			{
+				const uint mask = DrawList::read<uint>(data);
+				const Color color = DrawList::read<Color>(data);
+				if(mask & GraphicsContext::COLOR_BUFFER)
+				{
+					clearSurface(color);
+				}
+			}
+			break;
+
+		case DrawList::CMD_SET_RENDER_TARGET:
+		case DrawList::CMD_SWITCH_RENDER_TARGET:
+			{
+				RenderTarget2D *target = DrawList::read<RenderTarget2D*>(data);
+				if(target == renderTarget)
+				{
+					break;
+				}
+				renderTarget = target;
+				setRenderTarget(target);
+
+				// Setting a target resets the model-view matrix, switching keeps it
+				const uint w = target ? target->getWidth() : drawList.m_width, h = target ? target->getHeight() : drawList.m_height;
+				if(command == DrawList::CMD_SET_RENDER_TARGET)
+				{
+					m_matrixStack.assign(2, Matrix4());
+				}
+				m_projectionWidth = w;
+				m_projectionHeight = h;
+			}
+			break;
+
+		case DrawList::CMD_RESIZE_VIEWPORT:
+			{
+				m_projectionWidth = DrawList::read<uint>(data);
+				m_projectionHeight = DrawList::read<uint>(data);
+				m_matrixStack.assign(2, Matrix4());
+
+				// The screen may be rendered at another size than the list was recorded for
+				if(m_surface == &m_screen)
+				{
+					m_viewportWidth = m_projectionWidth * m_screen.width / max(drawList.m_width, 1u);
+					m_viewportHeight = m_projectionHeight * m_screen.height / max(drawList.m_height, 1u);
+				}
+				else
+				{
+					m_viewportWidth = m_projectionWidth;
+					m_viewportHeight = m_projectionHeight;
+				}
+			}
+			break;
+
+		case DrawList::CMD_SET_MODEL_VIEW_MATRIX:
+		case DrawList::CMD_PUSH_MATRIX:
+			{
+				float mat[16];
+				DrawList::read(data, mat);
+				if(command == DrawList::CMD_SET_MODEL_VIEW_MATRIX)
+				{
+					m_matrixStack.resize(2);
+					m_matrixStack[1] = Matrix4(mat);
+				}
+				else
+				{
+					m_matrixStack.push_back(m_matrixStack.back() * Matrix4(mat));
+				}
+			}
+			break;
+
+		case DrawList::CMD_POP_MATRIX:
+			if(m_matrixStack.size() > 1)
+			{
+				m_matrixStack.pop_back();
+			}
+			break;
+
+		case DrawList::CMD_SET_TEXTURE:
+			{
+				const uint slot = DrawList::read<uint>(data), index = DrawList::read<uint>(data);
+				m_textures[slot] = index == DrawList::NULL_RESOURCE ? nullptr : drawList.m_textures[index];
+			}
+			break;
+
+		case DrawList::CMD_SET_SHADER:
+			DrawList::read<uint>(data);
+			break;
+
+		case DrawList::CMD_SET_BLEND_STATE:
+			DrawList::read(data, m_blendState);
+			break;
+
+		case DrawList::CMD_DRAW_INDEXED_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = DrawList::read<GraphicsContext::PrimitiveType>(data);
+				const uint firstVertex = DrawList::read<uint>(data), vertexCount = DrawList::read<uint>(data), indexCount = DrawList::read<uint>(data);
+				const uint *indices = DrawList::readArray<uint>(data, indexCount);
+
+				vector<SpriteVertex> vertices(vertexCount);
+				for(uint i = 0; i < vertexCount; i++)
+				{
+					toSpriteVertex(drawList.m_vertices[firstVertex + i], vertices[i]);
+				}
+				addSpriteVertices(type, vertices.data(), vertexCount, indices, indexCount);
+			}
+			break;
+
+		case DrawList::CMD_DRAW_INDEXED_SPRITE_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = DrawList::read<GraphicsContext::PrimitiveType>(data);
+				const uint vertexCount = DrawList::read<uint>(data), indexCount = DrawList::read<uint>(data);
+				const SpriteVertex *vertices = DrawList::readArray<SpriteVertex>(data, vertexCount);
+				const uint *indices = DrawList::readArray<uint>(data, indexCount);
+				addSpriteVertices(type, vertices, vertexCount, indices, indexCount);
+			}
+			break;
+
+		case DrawList::CMD_DRAW_SPRITE_INSTANCES:
+			{
+				const uint instanceCount = DrawList::read<uint>(data);
+				const SpriteInstance *instances = DrawList::readArray<SpriteInstance>(data, instanceCount);
+
+				// Expand the instances the way the instanced sprite shader does
+				vector<SpriteVertex> vertices(instanceCount * 4);
+				vector<uint> indices(instanceCount * 6);
+				for(uint i = 0; i < instanceCount; i++)
+				{
+					const SpriteInstance &instance = instances[i];
+					const float c = cosf(instance.angle), s = sinf(instance.angle);
+					for(uint j = 0; j < 4; j++)
+					{
+						const float px = QUAD_VERTICES[j].x, py = QUAD_VERTICES[j].y;
+						const float lx = (px * instance.width - instance.originX) * instance.scaleX;
+						const float ly = (py * instance.height - instance.originY) * instance.scaleY;
+
+						SpriteVertex &vertex = vertices[i * 4 + j];
+						vertex.x = lx * c - ly * s + instance.x + instance.originX;
+						vertex.y = lx * s + ly * c + instance.y + instance.originY;
+						vertex.color = instance.color;
+						vertex.u = instance.u0 + (instance.u1 - instance.u0) * px;
+						vertex.v = instance.v1 + (instance.v0 - instance.v1) * py;
+						vertex.slot = 0.0f;
+					}
+
+					for(uint j = 0; j < 6; j++)
+					{
+						indices[i * 6 + j] = i * 4 + QUAD_INDICES[j];
+					}
+				}
+				addSpriteVertices(GraphicsContext::PRIMITIVE_TRIANGLES, vertices.data(), vertices.size(), indices.data(), indices.size());
+			}
+			break;
+
+		case DrawList::CMD_DRAW_INDEXED_BUFFERS:
+			{
+				DrawList::read<GraphicsContext::PrimitiveType>(data);
+				DrawList::read<const VertexBuffer*>(data);
+				DrawList::read<const IndexBuffer*>(data);
+				DrawList::read<uint>(data);
+				DrawList::read<uint>(data);
+				skippedBufferDraws = true;
+			}
+			break;
+
+		case DrawList::CMD_DRAW_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = DrawList::read<GraphicsContext::PrimitiveType>(data);
+				const uint firstVertex = DrawList::read<uint>(data), vertexCount = DrawList::read<uint>(data);
+
+				vector<SpriteVertex> vertices(vertexCount);
+				for(uint i = 0; i < vertexCount; i++)
+				{
+					toSpriteVertex(drawList.m_vertices[firstVertex + i], vertices[i]);
+				}
+				addSpriteVertices(type, vertices.data(), vertexCount, nullptr, vertexCount);
+			}
+			break;
+
+		case DrawList::CMD_DRAW_VERTEX_BUFFER:
+			{
+				DrawList::read<GraphicsContext::PrimitiveType>(data);
+				DrawList::read<const VertexBuffer*>(data);
+				skippedBufferDraws = true;
+			}
+			break;
+
+		case DrawList::CMD_DRAW_INDEXED_PACKED_VERTICES:
+		case DrawList::CMD_DRAW_PACKED_VERTICES:
+			{
+				const GraphicsContext::PrimitiveType type = DrawList::read<GraphicsContext::PrimitiveType>(data);
+				VertexFormat format;
+				DrawList::readFormat(data, format);
+				const uint vertexCount = DrawList::read<uint>(data);
+				const uint indexCount = command == DrawList::CMD_DRAW_INDEXED_PACKED_VERTICES ? DrawList::read<uint>(data) : vertexCount;
+
+				const char *vertexData = (const char*) DrawList::readArray(data, vertexCount * format.getVertexSizeInBytes(), alignment_of<float>::value);
+				vector<SpriteVertex> vertices(vertexCount);
+				for(uint i = 0; i < vertexCount; i++)
+				{
+					toSpriteVertex(format, vertexData + i * format.getVertexSizeInBytes(), vertices[i]);
+				}
+
+				const uint *indices = nullptr;
+				if(command == DrawList::CMD_DRAW_INDEXED_PACKED_VERTICES)
+				{
+					indices = DrawList::readArray<uint>(data, indexCount);
+				}
+				addSpriteVertices(type, vertices.data(), vertexCount, indices, indexCount);
+			}
+			break;
+		}
+	}
+
+	flush();
+	m_surface = nullptr;
+
+	// Buffer contents live on the GPU only
+	if(skippedBufferDraws)
+	{
+		LOG("SoftwareRasterizer::render(): Vertex buffer draws were skipped");
+	}
+}
+
+Pixmap SoftwareRasterizer::getPixmap() const
+{
+	return Pixmap(m_screen.width, m_screen.height, m_screen.pixels.data());
+}
+
+Pixmap SoftwareRasterizer::getPixmap(RenderTarget2D *renderTarget) const
+{
+	map<RenderTarget2D*, Surface>::const_iterator itr = m_targetSurfaces.find(renderTarget);
+	if(itr == m_targetSurfaces.end())
+	{
+		LOG("SoftwareRasterizer::getPixmap(): Nothing was drawn to the render target");
+		return Pixmap();
+	}
+	return Pixmap(itr->second.width, itr->second.height, itr->second.pixels.data());
+}
+
+void SoftwareRasterizer::setScissor(const Recti &rect)
+{
+	m_scissor = rect;
+}
+
+void SoftwareRasterizer::setTexturePixmap(const Texture2D *texture, const Pixmap &pixmap)
+{
+	copyPixmap(pixmap, m_textureSurfaces[texture]);
+}
+
+void SoftwareRasterizer::clearTextures()
+{
+	m_textureSurfaces.clear();
+}
+
+void SoftwareRasterizer::clearRenderTargets()
+{
+	m_targetSurfaces.clear();
+}
+
+void SoftwareRasterizer::setRenderTarget(RenderTarget2D *renderTarget)
+{
+	flush();
+
+	if(!renderTarget)
+	{
+		m_surface = &m_screen;
+		m_viewportWidth = m_screen.width;
+		m_viewportHeight = m_screen.height;
+		return;
+	}
+
+	Surface &surface = m_targetSurfaces[renderTarget];
+	if(surface.width != renderTarget->getWidth() || surface.height != renderTarget->getHeight())
+	{
+		surface.width = renderTarget->getWidth();
+		surface.height = renderTarget->getHeight();
+		surface.pixels.assign(surface.width * surface.height, 0);
+	}
+	surface.texture = renderTarget->getTexture().get();
+
+	m_surface = &surface;
+	m_viewportWidth = surface.width;
+	m_viewportHeight = surface.height;
+}
+
+void SoftwareRasterizer::clearSurface(const Color &color)
+{
+	flush();
+
+	// The clear color is stored as is, like a GL clear
+	uint pixel;
+	const uchar rgba[4] = { color.r, color.g, color.b, color.a };
+	memcpy(&pixel, rgba, sizeof(pixel));
+
+	int rect[4] = { 0, 0, (int) m_surface->width, (int) m_surface->height };
+	if(m_scissorTest)
+	{
+		rect[0] = max(rect[0], m_scissor.getX());
+		rect[1] = max(rect[1], m_scissor.getY());
+		rect[2] = min(rect[2], m_scissor.getRight());
+		rect[3] = min(rect[3], m_scissor.getBottom());
+	}
+
+	for(int y = rect[1]; y < rect[3]; y++)
+	{
+		uint *row = &m_surface->pixels[(m_surface->height - 1 - y) * m_surface->width];
+		fill(row + rect[0], row + max(rect[0], rect[2]), pixel);
+	}
+}
+
+void SoftwareRasterizer::getClipRect(int *rect) const
+{
+	// The GL viewport sits in the bottom-left corner of the surface
+	rect[0] = 0;
+	rect[1] = max(0, (int) m_surface->height - (int) m_viewportHeight);
+	rect[2] = min(m_viewportWidth, m_surface->width);
+	rect[3] = m_surface->height;
+	if(m_scissorTest)
+	{
+		rect[0] = max(rect[0], m_scissor.getX());
+		rect[1] = max(rect[1], m_scissor.getY());
+		rect[2] = min(rect[2], m_scissor.getRight());
+		rect[3] = min(rect[3], m_scissor.getBottom());
+	}
+}
+
+const SoftwareRasterizer::Surface *SoftwareRasterizer::getTextureSurface(const Texture2DPtr &texture)
+{
+	if(!texture)
+	{
+		return &m_whiteTexture;
+	}
+
+	// Render targets are sampled from what was drawn to them
+	for(map<RenderTarget2D*, Surface>::const_iterator itr = m_targetSurfaces.begin(); itr != m_targetSurfaces.end(); ++itr)
+	{
+		if(itr->second.texture == texture.get())
+		{
+			return &itr->second;
+		}
+	}
+
+	map<const Texture2D*, Surface>::iterator itr = m_textureSurfaces.find(texture.get());
+	if(itr == m_textureSurfaces.end())
+	{
+		itr = m_textureSurfaces.insert(make_pair(texture.get(), Surface())).first;
+		copyPixmap(texture->getPixmap(), itr->second);
+	}
+	return &itr->second;
+}
+
+void SoftwareRasterizer::copyPixmap(const Pixmap &pixmap, Surface &surface)
+{
+	const PixelFormat format = pixmap.getFormat();
+	if(format.getDataType() != PixelFormat::UNSIGNED_BYTE && format.getDataType() != PixelFormat::FLOAT)
+	{
+		LOG("SoftwareRasterizer::copyPixmap(): Only byte and float pixmaps can be sampled");
+		surface.width = surface.height = 1;
+		surface.pixels.assign(1, 0xFFFFFFFF);
+		return;
+	}
+
+	surface.width = pixmap.getWidth();
+	surface.height = pixmap.getHeight();
+	surface.pixels.resize(surface.width * surface.height);
+
+	// Missing components read as 0, and missing alpha as 1, like GL
+	const uint componentCount = format.getComponentCount();
+	const uchar *data = pixmap.getData();
+	for(uint i = 0; i < surface.pixels.size(); i++)
+	{
+		uchar rgba[4] = { 0, 0, 0, 255 };
+		for(uint j = 0; j < componentCount; j++)
+		{
+			if(format.getDataType() == PixelFormat::UNSIGNED_BYTE)
+			{
+				rgba[j] = data[i * componentCount + j];
+			}
+			else
+			{
+				float value;
+				memcpy(&value, data + (i * componentCount + j) * sizeof(float), sizeof(float));
+				rgba[j] = (uchar) (min(max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+			}
+		}
+		memcpy(&surface.pixels[i], rgba, sizeof(uint));
+	}
+}
+
+void SoftwareRasterizer::addSpriteVertices(const GraphicsContext::PrimitiveType type, const SpriteVertex *vertices, const uint vertexCount, const uint *indices, const uint indexCount)
+{
+	if(type != GraphicsContext::PRIMITIVE_TRIANGLES && type != GraphicsContext::PRIMITIVE_TRIANGLE_STRIP && type != GraphicsContext::PRIMITIVE_TRIANGLE_FAN)
+	{
+		return;
+	}
+
+	// Resolve the textures of this draw once
+	for(uint i = 0; i < GraphicsContext::MAX_TEXTURE_SLOTS; i++)
+	{
+		m_drawTextures[i] = nullptr;
+	}
+
+	for(uint i = 0; i + 2 < indexCount; i += type == GraphicsContext::PRIMITIVE_TRIANGLES ? 3 : 1)
+	{
+		uint i0 = indices ? indices[i] : i, i1 = indices ? indices[i + 1] : i + 1, i2 = indices ? indices[i + 2] : i + 2;
+		if(type == GraphicsContext::PRIMITIVE_TRIANGLE_FAN)
+		{
+			i0 = indices ? indices[0] : 0;
+		}
+		else if(type == GraphicsContext::PRIMITIVE_TRIANGLE_STRIP && (i & 1))
+		{
+			swap(i0, i1);
+		}
+
+		if(i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+		{
+			LOG("SoftwareRasterizer::addSpriteVertices(): Index out of range");
+			return;
+		}
+		addTriangle(vertices[i0], vertices[i1], vertices[i2]);
+	}
+}
+
+void SoftwareRasterizer::addTriangle(const SpriteVertex &v0, const SpriteVertex &v1, const SpriteVertex &v2)
+{
+	Triangle triangle;
+
+	// Transform to pixels. The projection maps [0, w] x [0, h] onto the viewport.
+	const Matrix4 &modelView = m_matrixStack.back();
+	const float *m = modelView.get();
+	const float scaleX = (float) m_viewportWidth / m_projectionWidth, scaleY = (float) m_viewportHeight / m_projectionHeight;
+	const float offsetY = (float) m_surface->height - (float) m_viewportHeight;
+	const SpriteVertex *vertices[3] = { &v0, &v1, &v2 };
+	for(int i = 0; i < 3; i++)
+	{
+		const SpriteVertex &vertex = *vertices[i];
+		triangle.x[i] = (m[0] * vertex.x + m[1] * vertex.y + m[3]) * scaleX;
+		triangle.y[i] = (m[4] * vertex.x + m[5] * vertex.y + m[7]) * scaleY + offsetY;
+		triangle.u[i] = vertex.u;
+		triangle.v[i] = vertex.v;
+
+		uchar rgba[4];
+		memcpy(rgba, &vertex.color, sizeof(rgba));
+		for(int j = 0; j < 4; j++)
+		{
+			triangle.color[i][j] = rgba[j] / 255.0f;
+		}
+	}
+
+	// Wind every triangle the same way, so the edge functions are positive inside
+	const float area = (triangle.y[0] - triangle.y[1]) * triangle.x[2] + (triangle.x[1] - triangle.x[0]) * triangle.y[2] + triangle.x[0] * triangle.y[1] - triangle.x[1] * triangle.y[0];
+	if(area == 0.0f || area != area)
+	{
+		return;
+	}
+	else if(area < 0.0f)
+	{
+		swap(triangle.x[1], triangle.x[2]);
+		swap(triangle.y[1], triangle.y[2]);
+		swap(triangle.u[1], triangle.u[2]);
+		swap(triangle.v[1], triangle.v[2]);
+		for(int j = 0; j < 4; j++)
+		{
+			swap(triangle.color[1][j], triangle.color[2][j]);
+		}
+	}
+
+	// The texture slot is flat, taken from the last vertex like GL
+	const uint slot = min((uint) max(v2.slot, 0.0f), GraphicsContext::MAX_TEXTURE_SLOTS - 1);
+	if(!m_drawTextures[slot])
+	{
+		m_drawTextures[slot] = getTextureSurface(m_textures[slot]);
+	}
+	triangle.texture = m_drawTextures[slot];
+
+	triangle.blend = m_blend;
+	triangle.blendFactors[0] = m_blendState.m_src;
+	triangle.blendFactors[1] = m_blendState.m_dst;
+	triangle.blendFactors[2] = m_blendState.m_alphaSrc;
+	triangle.blendFactors[3] = m_blendState.m_alphaDst;
+	getClipRect(triangle.clipRect);
+
+	m_triangles.push_back(triangle);
+}
+
+void SoftwareRasterizer::flush()
+{
+	if(m_triangles.empty())
+	{
+		return;
+	}
+
+	// Bin the triangles into the tiles they overlap, in submission order
+	const uint tilesX = (m_surface->width + TILE_SIZE - 1) / TILE_SIZE, tilesY = (m_surface->height + TILE_SIZE - 1) / TILE_SIZE;
+	m_bins.resize(tilesX * tilesY);
+	for(uint i = 0; i < m_bins.size(); i++)
+	{
+		m_bins[i].clear();
+	}
+
+	for(uint i = 0; i < m_triangles.size(); i++)
+	{
+		int bounds[4];
+		if(!getTriangleBounds(m_triangles[i].x, m_triangles[i].y, m_triangles[i].clipRect, bounds))
+		{
+			continue;
+		}
+
+		for(int y = bounds[1] / TILE_SIZE; y <= (bounds[3] - 1) / (int) TILE_SIZE; y++)
+		{
+			for(int x = bounds[0] / TILE_SIZE; x <= (bounds[2] - 1) / (int) TILE_SIZE; x++)
+			{
+				m_bins[y * tilesX + x].push_back(i);
+			}
+		}
+	}
+
+	// Tiles don't share pixels, so they are filled in parallel
+	const function<void(uint, uint)> fillTiles = [this, tilesX](uint begin, uint end)
+	{
+		for(uint tile = begin; tile < end; tile++)
+		{
+			const int tileLeft = (tile % tilesX) * TILE_SIZE, tileTop = (tile / tilesX) * TILE_SIZE;
+			const vector<uint> &bin = m_bins[tile];
+			for(uint i = 0; i < bin.size(); i++)
+			{
+				const Triangle &triangle = m_triangles[bin[i]];
+				int bounds[4];
+				getTriangleBounds(triangle.x, triangle.y, triangle.clipRect, bounds);
+				fillTriangle(triangle, max(bounds[0], tileLeft), max(bounds[1], tileTop), min(bounds[2], tileLeft + (int) TILE_SIZE), min(bounds[3], tileTop + (int) TILE_SIZE));
+			}
+		}
+	};
+
+	WorkerPool *workerPool = Engine::getWorkerPool();
+	if(workerPool)
+	{
+		workerPool->parallelFor(m_bins.size(), 1, fillTiles);
+	}
+	else
+	{
+		fillTiles(0, m_bins.size());
+	}
+
+	m_triangleCount += m_triangles.size();
+	m_triangles.clear();
+}
+
+void SoftwareRasterizer::fillTriangle(const Triangle &triangle, const int left, const int top, const int right, const int bottom)
+{
+	// Edge function i is positive on the inside of the edge from vertex i to
+	// the next, and is the weight of the vertex opposite to it. Pixels on an
+	// edge shared by two triangles belong to the triangle owning the edge.
+	float a[3], b[3], c[3];
+	bool owned[3];
+	for(int i = 0; i < 3; i++)
+	{
+		const int j = (i + 1) % 3;
+		a[i] = triangle.y[i] - triangle.y[j];
+		b[i] = triangle.x[j] - triangle.x[i];
+		c[i] = triangle.x[i] * triangle.y[j] - triangle.x[j] * triangle.y[i];
+		owned[i] = a[i] > 0.0f || (a[i] == 0.0f && b[i] < 0.0f);
+	}
+	const float invArea = 1.0f / (a[0] * triangle.x[2] + b[0] * triangle.y[2] + c[0]);
+
+	const Float4 color0 = loadFloat4(triangle.color[0]), color1 = loadFloat4(triangle.color[1]), color2 = loadFloat4(triangle.color[2]);
+	const Surface &texture = *triangle.texture;
+	const bool textured = triangle.texture != &m_whiteTexture;
+	const BlendState::BlendFactor *factors = triangle.blendFactors;
+
+	Surface &surface = *m_surface;
+	for(int y = top; y < bottom; y++)
+	{
+		const float px = left + 0.5f, py = y + 0.5f;
+		float e0 = a[0] * px + b[0] * py + c[0], e1 = a[1] * px + b[1] * py + c[1], e2 = a[2] * px + b[2] * py + c[2];
+		uint *pixel = &surface.pixels[(surface.height - 1 - y) * surface.width + left];
+
+		// Triangles are convex, so the span ends at the first pixel outside after one inside
+		bool inside = false;
+		for(int x = left; x < right; x++, pixel++, e0 += a[0], e1 += a[1], e2 += a[2])
+		{
+			if(!(e0 > 0.0f || (e0 == 0.0f && owned[0])) || !(e1 > 0.0f || (e1 == 0.0f && owned[1])) || !(e2 > 0.0f || (e2 == 0.0f && owned[2])))
+			{
+				if(inside) break;
+				continue;
+			}
+			inside = true;
+
+			const float w0 = e1 * invArea, w1 = e2 * invArea, w2 = e0 * invArea;
+			Float4 src = color0 * w0 + color1 * w1 + color2 * w2;
+			if(textured)
+			{
+				const float u = triangle.u[0] * w0 + triangle.u[1] * w1 + triangle.u[2] * w2;
+				const float v = triangle.v[0] * w0 + triangle.v[1] * w1 + triangle.v[2] * w2;
+				const uint tx = (uint) min(max(u * texture.width, 0.0f), texture.width - 1.0f);
+				const uint ty = (uint) min(max(v * texture.height, 0.0f), texture.height - 1.0f);
+				src = src * unpackColor(texture.pixels[ty * texture.width + tx]);
+			}
+
+			if(triangle.blend)
+			{
+				const Float4 dst = unpackColor(*pixel);
+				src = src * withAlpha(getBlendFactor(factors[0], src, dst), getBlendFactor(factors[2], src, dst)) +
+					dst * withAlpha(getBlendFactor(factors[1], src, dst), getBlendFactor(factors[3], src, dst));
+			}
+			*pixel = packColor(src);
+		}
+	}
+}
+
+END_XD_NAMESPACE
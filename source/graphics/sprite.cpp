@@ -10,6 +10,15 @@
 #include <x2d/engine.h>
 #include <x2d/graphics.h>
 
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define X2D_SPRITE_AVX2
+	#define X2D_SPRITE_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define X2D_SPRITE_SSE2
+#endif
+
 BEGIN_XD_NAMESPACE
 
 Sprite::Sprite(const Texture2DPtr texture, const Rect &rectangle, const Vector2 &origin, const float angle, const TextureRegion &region, const Color &color, const float depth, const Vector2 scale) :
@@ -123,16 +132,16 @@ void Sprite::scale(const float scl)
 
 void Sprite::getAABB(Vector2 *points) const
 {
-	Matrix4 mat;
-	mat.scale(m_size.x, m_size.y, 1.0f);
-	mat.translate(-m_origin.x, -m_origin.y, 0.0f);
-	mat.scale(m_scale.x, m_scale.y, 1.0f);
-	mat.rotateZ(m_angle);
-	mat.translate(m_position.x + m_origin.x, m_position.y + m_origin.y, 0.0f);
+	const SpriteTransformArrays transform = {
+		&m_position.x, &m_position.y, &m_size.x, &m_size.y,
+		&m_origin.x, &m_origin.y, &m_scale.x, &m_scale.y, &m_angle
+	};
 
+	float corners[8];
+	transformSpriteQuads(transform, 1, corners);
 	for(int i = 0; i < 4; i++)
 	{
-		points[i] = (mat * QUAD_VERTICES[i]).getXY();
+		points[i].set(corners[i * 2], corners[i * 2 + 1]);
 	}
 }
 
@@ -196,26 +205,36 @@ Texture2DPtr Sprite::getTexture() const
 	return m_texture;
 }
 
-void Sprite::getVertices(Vertex *vertices, uint *indices, const uint indexOffset) const
+void Sprite::getVertices(SpriteVertex *vertices, uint *indices, const uint indexOffset) const
+{
+	const SpriteTransformArrays transform = {
+		&m_position.x, &m_position.y, &m_size.x, &m_size.y,
+		&m_origin.x, &m_origin.y, &m_scale.x, &m_scale.y, &m_angle
+	};
+
+	float corners[8];
+	transformSpriteQuads(transform, 1, corners);
+	getVertices(corners, vertices, indices, indexOffset);
+}
+
+void Sprite::getVertices(const float *corners, SpriteVertex *vertices, uint *indices, const uint indexOffset, const uint textureSlot) const
 {
-	Matrix4 mat;
-	mat.scale(m_size.x, m_size.y, 1.0f);
-	mat.translate(-m_origin.x, -m_origin.y, 0.0f);
-	mat.scale(m_scale.x, m_scale.y, 1.0f);
-	mat.rotateZ(m_angle);
-	mat.translate(m_position.x + m_origin.x, m_position.y + m_origin.y, 0.0f);
+	uint color;
+	const uchar rgba[4] = { m_color.r, m_color.g, m_color.b, m_color.a };
+	memcpy(&color, rgba, sizeof(color));
 
 	for(int i = 0; i < 4; i++)
 	{
-		Vector2 pos = (mat * QUAD_VERTICES[i]).getXY();
-		vertices[i].set4f(VERTEX_POSITION, pos.x, pos.y);
-		vertices[i].set4ub(VERTEX_COLOR, m_color.r, m_color.g, m_color.b, m_color.a);
+		vertices[i].x = corners[i * 2];
+		vertices[i].y = corners[i * 2 + 1];
+		vertices[i].color = color;
+		vertices[i].slot = (float) textureSlot;
 	}
 
-	vertices[0].set4f(VERTEX_TEX_COORD, m_textureRegion.uv0.x, m_textureRegion.uv1.y);
-	vertices[1].set4f(VERTEX_TEX_COORD, m_textureRegion.uv1.x, m_textureRegion.uv1.y);
-	vertices[2].set4f(VERTEX_TEX_COORD, m_textureRegion.uv1.x, m_textureRegion.uv0.y);
-	vertices[3].set4f(VERTEX_TEX_COORD, m_textureRegion.uv0.x, m_textureRegion.uv0.y);
+	vertices[0].u = m_textureRegion.uv0.x; vertices[0].v = m_textureRegion.uv1.y;
+	vertices[1].u = m_textureRegion.uv1.x; vertices[1].v = m_textureRegion.uv1.y;
+	vertices[2].u = m_textureRegion.uv1.x; vertices[2].v = m_textureRegion.uv0.y;
+	vertices[3].u = m_textureRegion.uv0.x; vertices[3].v = m_textureRegion.uv0.y;
 	
 	indices[0] = indexOffset + QUAD_INDICES[0];
 	indices[1] = indexOffset + QUAD_INDICES[1];
@@ -225,4 +244,260 @@ void Sprite::getVertices(Vertex *vertices, uint *indices, const uint indexOffset
 	indices[5] = indexOffset + QUAD_INDICES[5];
 }
 
+void Sprite::getTransform(float *transform, const uint stride) const
+{
+	transform[0] = m_position.x;
+	transform[stride] = m_position.y;
+	transform[stride * 2] = m_size.x;
+	transform[stride * 3] = m_size.y;
+	transform[stride * 4] = m_origin.x;
+	transform[stride * 5] = m_origin.y;
+	transform[stride * 6] = m_scale.x;
+	transform[stride * 7] = m_scale.y;
+	transform[stride * 8] = m_angle;
+}
+
+void Sprite::getInstance(SpriteInstance *instance) const
+{
+	instance->x = m_position.x;
+	instance->y = m_position.y;
+	instance->width = m_size.x;
+	instance->height = m_size.y;
+	instance->originX = m_origin.x;
+	instance->originY = m_origin.y;
+	instance->scaleX = m_scale.x;
+	instance->scaleY = m_scale.y;
+	instance->angle = math::degToRad(m_angle);
+	instance->u0 = m_textureRegion.uv0.x;
+	instance->v0 = m_textureRegion.uv0.y;
+	instance->u1 = m_textureRegion.uv1.x;
+	instance->v1 = m_textureRegion.uv1.y;
+
+	const uchar rgba[4] = { m_color.r, m_color.g, m_color.b, m_color.a };
+	memcpy(&instance->color, rgba, sizeof(instance->color));
+}
+
+/*********************************************************************
+**	Batch transform													**
+**********************************************************************/
+
+// The transform is the same as building a Matrix4 with
+//   scale(size), translate(-origin), scale(scale), rotateZ(angle), translate(position + origin)
+// and multiplying it with each of the QUAD_VERTICES, written out per corner.
+// Every path below evaluates the terms in the same order.
+
+static inline void getRotation(const float angle, float &c, float &s)
+{
+	if(angle == 0.0f)
+	{
+		c = 1.0f; s = 0.0f;
+	}
+	else
+	{
+		const float rad = math::degToRad(angle);
+		c = cosf(rad); s = sinf(rad);
+	}
+}
+
+static inline void transformSpriteQuad(const SpriteTransformArrays &sprites, const uint i, float *corners)
+{
+	float c, s;
+	getRotation(sprites.angle[i], c, s);
+
+	const float x0 = -sprites.originX[i] * sprites.scaleX[i], x1 = (sprites.sizeX[i] - sprites.originX[i]) * sprites.scaleX[i];
+	const float y0 = -sprites.originY[i] * sprites.scaleY[i], y1 = (sprites.sizeY[i] - sprites.originY[i]) * sprites.scaleY[i];
+	const float tx = sprites.positionX[i] + sprites.originX[i], ty = sprites.positionY[i] + sprites.originY[i];
+
+	corners[0] = (x0 * c - y0 * s) + tx; corners[1] = (x0 * s + y0 * c) + ty;
+	corners[2] = (x1 * c - y0 * s) + tx; corners[3] = (x1 * s + y0 * c) + ty;
+	corners[4] = (x1 * c - y1 * s) + tx; corners[5] = (x1 * s + y1 * c) + ty;
+	corners[6] = (x0 * c - y1 * s) + tx; corners[7] = (x0 * s + y1 * c) + ty;
+}
+
+#ifdef X2D_SPRITE_SSE2
+// Transforms 4 sprites starting at i
+static inline void transformSpriteQuads4(const SpriteTransformArrays &sprites, const uint i, float *corners)
+{
+	float cosines[4], sines[4];
+	for(uint j = 0; j < 4; ++j)
+	{
+		getRotation(sprites.angle[i + j], cosines[j], sines[j]);
+	}
+
+	const __m128 c = _mm_loadu_ps(cosines), s = _mm_loadu_ps(sines);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 ox = _mm_loadu_ps(sprites.originX + i), oy = _mm_loadu_ps(sprites.originY + i);
+	const __m128 sx = _mm_loadu_ps(sprites.scaleX + i), sy = _mm_loadu_ps(sprites.scaleY + i);
+
+	const __m128 x0 = _mm_mul_ps(_mm_xor_ps(ox, signMask), sx), x1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(sprites.sizeX + i), ox), sx);
+	const __m128 y0 = _mm_mul_ps(_mm_xor_ps(oy, signMask), sy), y1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(sprites.sizeY + i), oy), sy);
+	const __m128 tx = _mm_add_ps(_mm_loadu_ps(sprites.positionX + i), ox), ty = _mm_add_ps(_mm_loadu_ps(sprites.positionY + i), oy);
+
+	// Corner x, y for all 4 sprites
+	const __m128 x0c = _mm_mul_ps(x0, c), x1c = _mm_mul_ps(x1, c), x0s = _mm_mul_ps(x0, s), x1s = _mm_mul_ps(x1, s);
+	const __m128 y0c = _mm_mul_ps(y0, c), y1c = _mm_mul_ps(y1, c), y0s = _mm_mul_ps(y0, s), y1s = _mm_mul_ps(y1, s);
+	const __m128 X0 = _mm_add_ps(_mm_sub_ps(x0c, y0s), tx), Y0 = _mm_add_ps(_mm_add_ps(x0s, y0c), ty);
+	const __m128 X1 = _mm_add_ps(_mm_sub_ps(x1c, y0s), tx), Y1 = _mm_add_ps(_mm_add_ps(x1s, y0c), ty);
+	const __m128 X2 = _mm_add_ps(_mm_sub_ps(x1c, y1s), tx), Y2 = _mm_add_ps(_mm_add_ps(x1s, y1c), ty);
+	const __m128 X3 = _mm_add_ps(_mm_sub_ps(x0c, y1s), tx), Y3 = _mm_add_ps(_mm_add_ps(x0s, y1c), ty);
+
+	// Interleave into x, y pairs per sprite
+	const __m128 a0 = _mm_unpacklo_ps(X0, Y0), b0 = _mm_unpackhi_ps(X0, Y0);
+	const __m128 a1 = _mm_unpacklo_ps(X1, Y1), b1 = _mm_unpackhi_ps(X1, Y1);
+	const __m128 a2 = _mm_unpacklo_ps(X2, Y2), b2 = _mm_unpackhi_ps(X2, Y2);
+	const __m128 a3 = _mm_unpacklo_ps(X3, Y3), b3 = _mm_unpackhi_ps(X3, Y3);
+
+	float *out = corners + i * 8;
+	_mm_storeu_ps(out + 0, _mm_movelh_ps(a0, a1)); _mm_storeu_ps(out + 4, _mm_movelh_ps(a2, a3));
+	_mm_storeu_ps(out + 8, _mm_movehl_ps(a1, a0)); _mm_storeu_ps(out + 12, _mm_movehl_ps(a3, a2));
+	_mm_storeu_ps(out + 16, _mm_movelh_ps(b0, b1)); _mm_storeu_ps(out + 20, _mm_movelh_ps(b2, b3));
+	_mm_storeu_ps(out + 24, _mm_movehl_ps(b1, b0)); _mm_storeu_ps(out + 28, _mm_movehl_ps(b3, b2));
+}
+#endif
+
+#ifdef X2D_SPRITE_AVX2
+// Transforms 8 sprites starting at i
+static inline void transformSpriteQuads8(const SpriteTransformArrays &sprites, const uint i, float *corners)
+{
+	float cosines[8], sines[8];
+	for(uint j = 0; j < 8; ++j)
+	{
+		getRotation(sprites.angle[i + j], cosines[j], sines[j]);
+	}
+
+	const __m256 c = _mm256_loadu_ps(cosines), s = _mm256_loadu_ps(sines);
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	const __m256 ox = _mm256_loadu_ps(sprites.originX + i), oy = _mm256_loadu_ps(sprites.originY + i);
+	const __m256 sx = _mm256_loadu_ps(sprites.scaleX + i), sy = _mm256_loadu_ps(sprites.scaleY + i);
+
+	const __m256 x0 = _mm256_mul_ps(_mm256_xor_ps(ox, signMask), sx), x1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(sprites.sizeX + i), ox), sx);
+	const __m256 y0 = _mm256_mul_ps(_mm256_xor_ps(oy, signMask), sy), y1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(sprites.sizeY + i), oy), sy);
+	const __m256 tx = _mm256_add_ps(_mm256_loadu_ps(sprites.positionX + i), ox), ty = _mm256_add_ps(_mm256_loadu_ps(sprites.positionY + i), oy);
+
+	// Corner x, y for all 8 sprites
+	const __m256 x0c = _mm256_mul_ps(x0, c), x1c = _mm256_mul_ps(x1, c), x0s = _mm256_mul_ps(x0, s), x1s = _mm256_mul_ps(x1, s);
+	const __m256 y0c = _mm256_mul_ps(y0, c), y1c = _mm256_mul_ps(y1, c), y0s = _mm256_mul_ps(y0, s), y1s = _mm256_mul_ps(y1, s);
+	const __m256 X0 = _mm256_add_ps(_mm256_sub_ps(x0c, y0s), tx), Y0 = _mm256_add_ps(_mm256_add_ps(x0s, y0c), ty);
+	const __m256 X1 = _mm256_add_ps(_mm256_sub_ps(x1c, y0s), tx), Y1 = _mm256_add_ps(_mm256_add_ps(x1s, y0c), ty);
+	const __m256 X2 = _mm256_add_ps(_mm256_sub_ps(x1c, y1s), tx), Y2 = _mm256_add_ps(_mm256_add_ps(x1s, y1c), ty);
+	const __m256 X3 = _mm256_add_ps(_mm256_sub_ps(x0c, y1s), tx), Y3 = _mm256_add_ps(_mm256_add_ps(x0s, y1c), ty);
+
+	// Interleave into x, y pairs per sprite. Each 128-bit lane holds half of a sprite,
+	// the low lanes sprites i to i + 3 and the high lanes sprites i + 4 to i + 7.
+	const __m256 a0 = _mm256_unpacklo_ps(X0, Y0), b0 = _mm256_unpackhi_ps(X0, Y0);
+	const __m256 a1 = _mm256_unpacklo_ps(X1, Y1), b1 = _mm256_unpackhi_ps(X1, Y1);
+	const __m256 a2 = _mm256_unpacklo_ps(X2, Y2), b2 = _mm256_unpackhi_ps(X2, Y2);
+	const __m256 a3 = _mm256_unpacklo_ps(X3, Y3), b3 = _mm256_unpackhi_ps(X3, Y3);
+
+	const __m256 p0 = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 0, 1, 0)), q0 = _mm256_shuffle_ps(a2, a3, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m256 p1 = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 2, 3, 2)), q1 = _mm256_shuffle_ps(a2, a3, _MM_SHUFFLE(3, 2, 3, 2));
+	const __m256 p2 = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(1, 0, 1, 0)), q2 = _mm256_shuffle_ps(b2, b3, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m256 p3 = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 2, 3, 2)), q3 = _mm256_shuffle_ps(b2, b3, _MM_SHUFFLE(3, 2, 3, 2));
+
+	float *out = corners + i * 8;
+	_mm256_storeu_ps(out + 0, _mm256_permute2f128_ps(p0, q0, 0x20)); _mm256_storeu_ps(out + 32, _mm256_permute2f128_ps(p0, q0, 0x31));
+	_mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(p1, q1, 0x20)); _mm256_storeu_ps(out + 40, _mm256_permute2f128_ps(p1, q1, 0x31));
+	_mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(p2, q2, 0x20)); _mm256_storeu_ps(out + 48, _mm256_permute2f128_ps(p2, q2, 0x31));
+	_mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(p3, q3, 0x20)); _mm256_storeu_ps(out + 56, _mm256_permute2f128_ps(p3, q3, 0x31));
+}
+#endif
+
+// The bounds follow from the transform above. Each corner coordinate is a sum of
+// one x term and one y term, so the extremes are the sums of the term extremes.
+static inline bool isSpriteQuadVisible(const SpriteTransformArrays &sprites, const uint i, const float minX, const float minY, const float maxX, const float maxY)
+{
+	float c, s;
+	getRotation(sprites.angle[i], c, s);
+
+	const float x0 = -sprites.originX[i] * sprites.scaleX[i], x1 = (sprites.sizeX[i] - sprites.originX[i]) * sprites.scaleX[i];
+	const float y0 = -sprites.originY[i] * sprites.scaleY[i], y1 = (sprites.sizeY[i] - sprites.originY[i]) * sprites.scaleY[i];
+	const float tx = sprites.positionX[i] + sprites.originX[i], ty = sprites.positionY[i] + sprites.originY[i];
+
+	const float x0c = x0 * c, x1c = x1 * c, x0s = x0 * s, x1s = x1 * s;
+	const float y0c = y0 * c, y1c = y1 * c, y0s = y0 * s, y1s = y1 * s;
+	const float boundsMinX = (min(x0c, x1c) - max(y0s, y1s)) + tx, boundsMaxX = (max(x0c, x1c) - min(y0s, y1s)) + tx;
+	const float boundsMinY = (min(x0s, x1s) + min(y0c, y1c)) + ty, boundsMaxY = (max(x0s, x1s) + max(y0c, y1c)) + ty;
+
+	return boundsMaxX >= minX && boundsMinX <= maxX && boundsMaxY >= minY && boundsMinY <= maxY;
+}
+
+#ifdef X2D_SPRITE_SSE2
+// Tests 4 sprites starting at i and returns a 4 bit visibility mask
+static inline int cullSpriteQuads4(const SpriteTransformArrays &sprites, const uint i, const __m128 minX, const __m128 minY, const __m128 maxX, const __m128 maxY)
+{
+	float cosines[4], sines[4];
+	for(uint j = 0; j < 4; ++j)
+	{
+		getRotation(sprites.angle[i + j], cosines[j], sines[j]);
+	}
+
+	const __m128 c = _mm_loadu_ps(cosines), s = _mm_loadu_ps(sines);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 ox = _mm_loadu_ps(sprites.originX + i), oy = _mm_loadu_ps(sprites.originY + i);
+	const __m128 sx = _mm_loadu_ps(sprites.scaleX + i), sy = _mm_loadu_ps(sprites.scaleY + i);
+
+	const __m128 x0 = _mm_mul_ps(_mm_xor_ps(ox, signMask), sx), x1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(sprites.sizeX + i), ox), sx);
+	const __m128 y0 = _mm_mul_ps(_mm_xor_ps(oy, signMask), sy), y1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(sprites.sizeY + i), oy), sy);
+	const __m128 tx = _mm_add_ps(_mm_loadu_ps(sprites.positionX + i), ox), ty = _mm_add_ps(_mm_loadu_ps(sprites.positionY + i), oy);
+
+	const __m128 x0c = _mm_mul_ps(x0, c), x1c = _mm_mul_ps(x1, c), x0s = _mm_mul_ps(x0, s), x1s = _mm_mul_ps(x1, s);
+	const __m128 y0c = _mm_mul_ps(y0, c), y1c = _mm_mul_ps(y1, c), y0s = _mm_mul_ps(y0, s), y1s = _mm_mul_ps(y1, s);
+	const __m128 boundsMinX = _mm_add_ps(_mm_sub_ps(_mm_min_ps(x0c, x1c), _mm_max_ps(y0s, y1s)), tx);
+	const __m128 boundsMaxX = _mm_add_ps(_mm_sub_ps(_mm_max_ps(x0c, x1c), _mm_min_ps(y0s, y1s)), tx);
+	const __m128 boundsMinY = _mm_add_ps(_mm_add_ps(_mm_min_ps(x0s, x1s), _mm_min_ps(y0c, y1c)), ty);
+	const __m128 boundsMaxY = _mm_add_ps(_mm_add_ps(_mm_max_ps(x0s, x1s), _mm_max_ps(y0c, y1c)), ty);
+
+	const __m128 overlapX = _mm_and_ps(_mm_cmpge_ps(boundsMaxX, minX), _mm_cmple_ps(boundsMinX, maxX));
+	const __m128 overlapY = _mm_and_ps(_mm_cmpge_ps(boundsMaxY, minY), _mm_cmple_ps(boundsMinY, maxY));
+	return _mm_movemask_ps(_mm_and_ps(overlapX, overlapY));
+}
+#endif
+
+uint cullSpriteQuads(const SpriteTransformArrays &sprites, const uint count, const Rect &rect, uchar *visible)
+{
+	const float minX = rect.position.x, minY = rect.position.y;
+	const float maxX = rect.position.x + rect.size.x, maxY = rect.position.y + rect.size.y;
+
+	uint visibleCount = 0, i = 0;
+#ifdef X2D_SPRITE_SSE2
+	const __m128 minX4 = _mm_set1_ps(minX), minY4 = _mm_set1_ps(minY), maxX4 = _mm_set1_ps(maxX), maxY4 = _mm_set1_ps(maxY);
+	for(; i + 4 <= count; i += 4)
+	{
+		const int mask = cullSpriteQuads4(sprites, i, minX4, minY4, maxX4, maxY4);
+		for(uint j = 0; j < 4; ++j)
+		{
+			visible[i + j] = (mask >> j) & 1;
+			visibleCount += visible[i + j];
+		}
+	}
+#endif
+	for(; i < count; ++i)
+	{
+		visible[i] = isSpriteQuadVisible(sprites, i, minX, minY, maxX, maxY) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+void transformSpriteQuads(const SpriteTransformArrays &sprites, const uint count, float *corners)
+{
+	uint i = 0;
+#ifdef X2D_SPRITE_AVX2
+	for(; i + 8 <= count; i += 8)
+	{
+		transformSpriteQuads8(sprites, i, corners);
+	}
+#endif
+#ifdef X2D_SPRITE_SSE2
+	for(; i + 4 <= count; i += 4)
+	{
+		transformSpriteQuads4(sprites, i, corners);
+	}
+#endif
+	for(; i < count; ++i)
+	{
+		transformSpriteQuad(sprites, i, corners + i * 8);
+	}
+}
+
 END_XD_NAMESPACE
\ No newline at end of file
@@ -12,13 +12,35 @@
 
 BEGIN_XD_NAMESPACE
 
-SpriteBatch::SpriteBatch(GraphicsContext &graphicsContext) : 
-	m_graphicsContext(graphicsContext),
-	m_beingCalled(false)
+// Sort key layout: [63..32] depth, [31..20] texture slot, [19..0] submission index
+const uint SORT_KEY_TEXTURE_SHIFT = 20;
+const uint64_t SORT_KEY_TEXTURE_MASK = 0xFFF;
+const uint64_t SORT_KEY_INDEX_MASK = 0xFFFFF;
+
+// Sprites in a batch are limited by the index bits of the sort key
+const uint MAX_SPRITE_CAPACITY = (uint) SORT_KEY_INDEX_MASK + 1;
+
+// Number of batches TEXTURE mode looks back through for a matching texture
+const int TEXTURE_BATCH_SEARCH_LIMIT = 64;
+
+// Batches smaller than this generate their vertices on the calling thread
+const uint PARALLEL_VERTEX_THRESHOLD = 4096;
+const uint PARALLEL_VERTEX_CHUNK_SIZE = 1024;
+
+SpriteBatch::SpriteBatch(GraphicsContext &graphicsContext, const uint capacity) : 
+	m_beingCalled(false),
+	m_vertices(0),
+	m_indices(0),
+	m_sprites(0),
+	m_spriteCount(0),
+	m_capacity(0),
+	m_maxCapacity(MAX_SPRITE_CAPACITY),
+	m_peakSpriteCount(0),
+	m_autoFlushCount(0),
+	m_culledSpriteCount(0),
+	m_graphicsContext(graphicsContext)
 {
-	m_sprites = new Sprite[2084];
-	m_vertices = new Vertex[8912];
-	m_indices = new uint[12288];
+	setCapacity(min(max(capacity, 1u), MAX_SPRITE_CAPACITY));
 }
 
 SpriteBatch::~SpriteBatch()
@@ -44,6 +66,20 @@ void SpriteBatch::begin(const State &state)
 	m_prevState.blendState = m_graphicsContext.getBlendState();
 	m_prevState.shader = m_graphicsContext.getShader();
 	m_prevTexture = m_graphicsContext.getTexture();
+
+	m_stats = Stats();
+	m_contextStats = m_graphicsContext.getStats();
+
+	if(m_state.instanced && !Graphics::isInstancingSupported())
+	{
+		m_state.instanced = false;
+	}
+
+	// Sprites are drawn as they are recieved, so the state is applied here
+	if(m_state.mode == IMMEDIATE)
+	{
+		applyState();
+	}
 }
 
 void SpriteBatch::drawSprite(const Sprite &sprite)
@@ -60,6 +96,39 @@ void SpriteBatch::drawSprite(const Sprite &sprite)
 		return;
 	}
 
+	// Draw the sprite straight away
+	if(m_state.mode == IMMEDIATE)
+	{
+		++m_stats.spriteCount;
+		m_graphicsContext.setTexture(sprite.m_texture);
+		if(m_state.instanced)
+		{
+			SpriteInstance instance;
+			sprite.getInstance(&instance);
+			m_graphicsContext.drawSpriteInstances(&instance, 1);
+		}
+		else
+		{
+			sprite.getVertices(m_vertices, m_indices);
+			m_graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_vertices, 4, m_indices, 6);
+		}
+		return;
+	}
+
+	// Make room for the sprite
+	if(m_spriteCount == m_capacity)
+	{
+		if(m_capacity < m_maxCapacity)
+		{
+			setCapacity(min(m_capacity * 2, m_maxCapacity));
+		}
+		else
+		{
+			++m_autoFlushCount;
+			flush();
+		}
+	}
+
 	m_sprites[m_spriteCount++] = sprite;
 }
 
@@ -76,6 +145,30 @@ void SpriteBatch::drawText(const Vector2 &pos, const string &text, const FontPtr
 	font->draw(this, pos, text);
 }
 
+void SpriteBatch::drawParticles(const ParticleSystem &particles)
+{
+	if(!m_beingCalled)
+	{
+		LOG("SpriteBatch::drawParticles(): Called before begin()");
+		return;
+	}
+
+	if(!particles.getTexture())
+	{
+		LOG("SpriteBatch::drawParticles(): Particle system needs a texture.");
+		return;
+	}
+
+	m_particleSystems.push_back(&particles);
+
+	// Draw the particles straight away
+	if(m_state.mode == IMMEDIATE)
+	{
+		drawParticleSystems();
+		m_particleSystems.clear();
+	}
+}
+
 void SpriteBatch::end()
 {
 	if(!m_beingCalled)
@@ -84,79 +177,104 @@ void SpriteBatch::end()
 		return;
 	}
 	
-	// Draw sprites
-	if(m_spriteCount > 0)
+	m_peakSpriteCount = max(m_peakSpriteCount, m_spriteCount);
+
+	// Drop sprites outside the viewport
+	if(m_state.cull && m_spriteCount > 0 && m_state.mode != IMMEDIATE)
+	{
+		const uint spriteCount = m_spriteCount;
+		cullSprites();
+		m_stats.culledSpriteCount = spriteCount - m_spriteCount;
+	}
+
+	// Draw sprites. In IMMEDIATE mode they have been drawn already.
+	if(m_spriteCount > 0 && m_state.mode != IMMEDIATE)
 	{
-		switch(m_state.mode)
+		m_stats.spriteCount = m_spriteCount;
+		applyState();
+
+		// Sort sprites as given by the sort mode
+		m_timer.start();
+		const uint64_t *sortKeys = sortSprites();
+
+		// Split the sprites into draw calls
+		findDrawRuns(sortKeys);
+		m_stats.sortTime = m_timer.getElapsedTime();
+
+		// Generate vertex or instance data. Sprites write to disjoint parts of
+		// the buffers, so large batches are split across the worker threads.
+		m_timer.start();
+		if(m_state.instanced)
+		{
+			m_instances.resize(m_spriteCount);
+		}
+		else
+		{
+			m_transformData.resize(m_spriteCount * 17);
+		}
+
+		WorkerPool *workerPool = Engine::getWorkerPool();
+		if(workerPool && m_spriteCount >= PARALLEL_VERTEX_THRESHOLD)
 		{
-			case DEFERRED:
+			workerPool->parallelFor(m_spriteCount, PARALLEL_VERTEX_CHUNK_SIZE, [this, sortKeys](uint begin, uint end)
 			{
-				// Sprites are not drawn until end() is called. end() will apply graphics
-				// device settings and draw all the sprites in one batch, in the same
-				// order calls to draw*() were recieved. This mode allows draw*() calls
-				// to two or more instances of SpriteBatch without introducing conflicting
-				// graphics device settings. SpriteBatch defaults to DEFERRED mode.
-
-				m_graphicsContext.setModelViewMatrix(m_state.projectionMatix);
-				m_graphicsContext.setBlendState(m_state.blendState);
-				m_graphicsContext.setShader(m_state.shader);
-
-				// Separate sprites by depth and texture
-				map<float, map<Texture2DPtr, list<Sprite*>>> layerTextureMap;
-				for(uint i = 0; i < m_spriteCount; ++i)
-				{
-					Sprite *sprite = &m_sprites[i];
-					layerTextureMap[sprite->m_depth][sprite->m_texture].push_back(sprite);
-				}
+				generateVertices(sortKeys, begin, end);
+			});
+		}
+		else
+		{
+			generateVertices(sortKeys, 0, m_spriteCount);
+		}
+		m_stats.vertexTime = m_timer.getElapsedTime();
 
-				// For each depth
-				for(map<float, map<Texture2DPtr, list<Sprite*>>>::iterator itr1 = layerTextureMap.begin(); itr1 != layerTextureMap.end(); ++itr1)
-				{
-					// For each texture
-					uint spriteCount = 0;
-					for(map<Texture2DPtr, list<Sprite*>>::iterator itr2 = itr1->second.begin(); itr2 != itr1->second.end(); ++itr2)
-					{
-						// Batch all sprite vertex data
-						for(list<Sprite*>::iterator itr3 = itr2->second.begin(); itr3 != itr2->second.end(); ++itr3)
-						{
-							(*itr3)->getVertices(m_vertices + spriteCount * 4, m_indices + spriteCount * 6, spriteCount * 4);
-							spriteCount++;
-						}
-
-						// If we have sprites
-						if(spriteCount > 0)
-						{
-							// Draw textured primitives
-							m_graphicsContext.setTexture(itr2->first);
-							m_graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_vertices, spriteCount * 4, m_indices, spriteCount * 6);
-							spriteCount = 0;
-						}
-					}
-				}
+		// Draw one batch per run, binding the textures of the run to their slots
+		m_timer.start();
+		for(uint run = 0; run + 1 < m_runStarts.size(); ++run)
+		{
+			const uint runStart = m_runStarts[run], runLength = m_runStarts[run + 1] - runStart;
+			for(uint slot = 0; slot < m_runTextureStarts[run + 1] - m_runTextureStarts[run]; ++slot)
+			{
+				m_graphicsContext.setTexture(slot, m_runTextures[m_runTextureStarts[run] + slot]);
 			}
-			break;
 
-			case TEXTURE:
+			if(m_state.instanced)
 			{
-				// Sort sprites by texture. Draw forwards and batch together
-				// similar textures, as long as they don't overlap a different texture.
-				/*uint prevIndex = 0;
-				Texture2DPtr prevTexture = m_sprites[0].texture;
-				for(uint i = 0; i < m_spriteCount; ++i)
-				{
-					if(m_sprites[i].texture != prevTexture)
-					{
-						m_graphicsContext.setTexture(m_sprites[i].texture);
-						m_graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_vertices + prevIndex * 4, (i - prevIndex) * 4, m_indices + prevIndex * 6, (i - prevIndex) * 6);
-						prevIndex = i;
-					}
-				}
-				m_graphicsContext.setTexture(m_sprites[prevIndex].texture);
-				m_graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_vertices + prevIndex * 4, (m_spriteCount - prevIndex) * 4, m_indices + prevIndex * 6, (m_spriteCount - prevIndex) * 6);*/
+				m_graphicsContext.drawSpriteInstances(m_instances.data() + runStart, runLength);
+			}
+			else
+			{
+				m_graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_vertices + runStart * 4, runLength * 4, m_indices + runStart * 6, runLength * 6);
 			}
-			break;
 		}
+
+		m_stats.submitTime = m_timer.getElapsedTime();
+	}
+
+	// Draw particles on top of the sprites
+	if(!m_particleSystems.empty())
+	{
+		applyState();
+		m_timer.start();
+		drawParticleSystems();
+		m_stats.submitTime += m_timer.getElapsedTime();
+		m_particleSystems.clear();
+	}
+
+	// Release the textures held by the extra slots
+	for(uint slot = 1; slot < GraphicsContext::MAX_TEXTURE_SLOTS; ++slot)
+	{
+		m_graphicsContext.setTexture(slot, nullptr);
 	}
+
+	// Collect what the graphics context did for this batch
+	const GraphicsContext::Stats contextStats = m_graphicsContext.getStats();
+	m_stats.drawCalls = contextStats.drawCalls - m_contextStats.drawCalls;
+	m_stats.glCalls = contextStats.glCalls - m_contextStats.glCalls;
+	m_stats.textureChanges = contextStats.textureChanges - m_contextStats.textureChanges;
+	m_stats.shaderChanges = contextStats.shaderChanges - m_contextStats.shaderChanges;
+	m_stats.blendStateChanges = contextStats.blendStateChanges - m_contextStats.blendStateChanges;
+	m_stats.vertexBytes = contextStats.vertexBytes - m_contextStats.vertexBytes;
+	m_stats.indexBytes = contextStats.indexBytes - m_contextStats.indexBytes;
 		
 	m_graphicsContext.setModelViewMatrix(m_prevState.projectionMatix);
 	m_graphicsContext.setBlendState(m_prevState.blendState);
@@ -166,6 +284,187 @@ void SpriteBatch::end()
 	m_beingCalled = false;
 }
 
+void SpriteBatch::generateVertices(const uint64_t *sortKeys, const uint begin, const uint end)
+{
+	// Instances are expanded on the GPU
+	if(m_state.instanced)
+	{
+		for(uint i = begin; i < end; ++i)
+		{
+			m_sprites[sortKeys[i] & SORT_KEY_INDEX_MASK].getInstance(&m_instances[i]);
+		}
+		return;
+	}
+
+	// Gather sprite transforms in sorted order, one array per component,
+	// followed by 8 floats of quad corners per sprite
+	const uint count = m_spriteCount;
+	float *data = m_transformData.data();
+	for(uint i = begin; i < end; ++i)
+	{
+		m_sprites[sortKeys[i] & SORT_KEY_INDEX_MASK].getTransform(data + i, count);
+	}
+
+	// Transform the quads at once
+	const SpriteTransformArrays transforms = {
+		data + begin, data + count + begin, data + count * 2 + begin, data + count * 3 + begin,
+		data + count * 4 + begin, data + count * 5 + begin, data + count * 6 + begin, data + count * 7 + begin, data + count * 8 + begin
+	};
+
+	float *corners = data + count * 9;
+	transformSpriteQuads(transforms, end - begin, corners + begin * 8);
+
+	// Indices are relative to the start of the texture run
+	uint run = upper_bound(m_runStarts.begin(), m_runStarts.end(), begin) - m_runStarts.begin() - 1;
+	for(uint i = begin; i < end; ++i)
+	{
+		if(i == m_runStarts[run + 1])
+		{
+			++run;
+		}
+
+		const Sprite &sprite = m_sprites[sortKeys[i] & SORT_KEY_INDEX_MASK];
+		sprite.getVertices(corners + i * 8, m_vertices + i * 4, m_indices + i * 6, (i - m_runStarts[run]) * 4, m_spriteTextureSlots[i]);
+	}
+}
+
+void SpriteBatch::cullSprites()
+{
+	// The view matrix maps sprites to viewport pixels, so its inverse
+	// maps the viewport corners back to a visible rectangle
+	Matrix4 inverseView = m_state.projectionMatix;
+	inverseView.invert();
+
+	const float width = (float) m_graphicsContext.getWidth(), height = (float) m_graphicsContext.getHeight();
+	const Vector4 viewportCorners[4] = {
+		Vector4(0.0f, 0.0f, 0.0f, 1.0f),
+		Vector4(width, 0.0f, 0.0f, 1.0f),
+		Vector4(width, height, 0.0f, 1.0f),
+		Vector4(0.0f, height, 0.0f, 1.0f)
+	};
+
+	Vector2 viewMin = (inverseView * viewportCorners[0]).getXY(), viewMax = viewMin;
+	for(uint i = 1; i < 4; ++i)
+	{
+		const Vector2 corner = (inverseView * viewportCorners[i]).getXY();
+		viewMin.set(min(viewMin.x, corner.x), min(viewMin.y, corner.y));
+		viewMax.set(max(viewMax.x, corner.x), max(viewMax.y, corner.y));
+	}
+
+	// Test sprite bounds against the visible rectangle
+	const uint count = m_spriteCount;
+	m_transformData.resize(count * 9);
+	float *data = m_transformData.data();
+	for(uint i = 0; i < count; ++i)
+	{
+		m_sprites[i].getTransform(data + i, count);
+	}
+
+	const SpriteTransformArrays transforms = {
+		data, data + count, data + count * 2, data + count * 3,
+		data + count * 4, data + count * 5, data + count * 6, data + count * 7, data + count * 8
+	};
+
+	m_spriteVisibility.resize(count);
+	const uint visibleCount = cullSpriteQuads(transforms, count, Rect(viewMin, viewMax - viewMin), m_spriteVisibility.data());
+	if(visibleCount == count)
+	{
+		return;
+	}
+
+	// Remove culled sprites, keeping the submission order
+	uint j = 0;
+	for(uint i = 0; i < count; ++i)
+	{
+		if(m_spriteVisibility[i])
+		{
+			if(i != j)
+			{
+				m_sprites[j] = m_sprites[i];
+			}
+			++j;
+		}
+	}
+
+	m_culledSpriteCount += count - visibleCount;
+	m_spriteCount = visibleCount;
+}
+
+void SpriteBatch::drawParticleSystems()
+{
+	// Order the systems by texture, in the order the textures first appear
+	m_textureSlots.clear();
+	for(uint i = 0; i < m_particleSystems.size(); ++i)
+	{
+		const Texture2D *texture = m_particleSystems[i]->m_texture.get();
+		if(m_textureSlots.find(texture) == m_textureSlots.end())
+		{
+			const uint slot = m_textureSlots.size();
+			m_textureSlots[texture] = slot;
+		}
+	}
+	stable_sort(m_particleSystems.begin(), m_particleSystems.end(), [this](const ParticleSystem *a, const ParticleSystem *b)
+	{
+		return m_textureSlots.find(a->m_texture.get())->second < m_textureSlots.find(b->m_texture.get())->second;
+	});
+
+	// Custom shaders only sample one texture
+	const uint slotCount = m_state.shader ? 1 : Graphics::getTextureSlotCount();
+	const uint systemCount = m_particleSystems.size();
+	for(uint first = 0; first < systemCount;)
+	{
+		// Take systems until every texture slot is used
+		uint last = first, textureCount = 0, particleCount = 0;
+		for(; last < systemCount; ++last)
+		{
+			const ParticleSystem *particles = m_particleSystems[last];
+			if(last == first || particles->m_texture != m_particleSystems[last - 1]->m_texture)
+			{
+				if(textureCount == slotCount)
+				{
+					break;
+				}
+				m_graphicsContext.setTexture(textureCount++, particles->m_texture);
+			}
+			particleCount += particles->m_count;
+		}
+
+		// Write the quads of the group into one vertex stream
+		if(m_particleVertices.size() < particleCount * 4)
+		{
+			m_particleVertices.resize(particleCount * 4);
+			m_particleIndices.resize(particleCount * 6);
+		}
+
+		uint offset = 0, slot = 0;
+		for(uint i = first; i < last; ++i)
+		{
+			const ParticleSystem *particles = m_particleSystems[i];
+			if(i != first && particles->m_texture != m_particleSystems[i - 1]->m_texture)
+			{
+				++slot;
+			}
+			particles->getVertices(m_particleVertices.data() + offset * 4, m_particleIndices.data() + offset * 6, offset * 4, slot);
+			offset += particles->m_count;
+		}
+
+		if(particleCount > 0)
+		{
+			m_graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_particleVertices.data(), particleCount * 4, m_particleIndices.data(), particleCount * 6);
+		}
+
+		m_stats.particleCount += particleCount;
+		first = last;
+	}
+}
+
+void SpriteBatch::applyState()
+{
+	m_graphicsContext.setModelViewMatrix(m_state.projectionMatix);
+	m_graphicsContext.setBlendState(m_state.blendState);
+	m_graphicsContext.setShader(m_state.shader);
+}
+
 void SpriteBatch::flush()
 {
 	if(!m_beingCalled)
@@ -179,33 +478,248 @@ void SpriteBatch::flush()
 	begin(m_state);
 }
 
-// TODO: Can we make this more efficient?
+void SpriteBatch::setMaxCapacity(const uint maxCapacity)
+{
+	m_maxCapacity = min(max(maxCapacity, 1u), MAX_SPRITE_CAPACITY);
+
+	// Shrink storage if it is above the new max. Sprites that don't fit are drawn first.
+	if(m_capacity > m_maxCapacity)
+	{
+		if(m_beingCalled && m_spriteCount > m_maxCapacity)
+		{
+			flush();
+		}
+		setCapacity(m_maxCapacity);
+	}
+}
+
+void SpriteBatch::resetUsageStats()
+{
+	m_peakSpriteCount = 0;
+	m_autoFlushCount = 0;
+	m_culledSpriteCount = 0;
+}
+
+void SpriteBatch::setCapacity(const uint capacity)
+{
+	// Keep the sprites of the current batch
+	m_spriteCount = min(m_spriteCount, capacity);
+	Sprite *sprites = new Sprite[capacity];
+	for(uint i = 0; i < m_spriteCount; ++i)
+	{
+		sprites[i] = m_sprites[i];
+	}
+	delete[] m_sprites;
+	m_sprites = sprites;
+
+	// Vertices and indices are generated in end(), so they can be discarded
+	delete[] m_vertices;
+	delete[] m_indices;
+	m_vertices = new SpriteVertex[capacity * 4];
+	m_indices = new uint[capacity * 6];
+
+	m_capacity = capacity;
+}
+
 uint SpriteBatch::getTextureSwapCount() const
 {
-	// Separate sprites by depth and texture
-	map<float, map<Texture2DPtr, list<Sprite*>>> layerTextureMap;
+	if(m_spriteCount == 0)
+	{
+		return 0;
+	}
+
+	// Count draw calls in sorted order
+	findDrawRuns(sortSprites());
+	return m_runStarts.size() - 1;
+}
+
+void SpriteBatch::findDrawRuns(const uint64_t *sortKeys) const
+{
+	// Custom shaders and instances only sample one texture
+	const uint slotCount = m_state.instanced || m_state.shader ? 1 : Graphics::getTextureSlotCount();
+
+	m_runStarts.clear();
+	m_runTextureStarts.clear();
+	m_runTextures.clear();
+	m_spriteTextureSlots.resize(m_spriteCount);
+
+	uint runTextureStart = 0, slot = 0;
 	for(uint i = 0; i < m_spriteCount; ++i)
 	{
-		Sprite *sprite = &m_sprites[i];
-		layerTextureMap[sprite->m_depth][sprite->m_texture].push_back(sprite);
+		const Texture2DPtr &texture = m_sprites[sortKeys[i] & SORT_KEY_INDEX_MASK].m_texture;
+
+		// Look for the texture among the textures of the run. Most of the
+		// time it is the same as the previous sprite's.
+		if(i == 0 || m_runTextures[runTextureStart + slot] != texture)
+		{
+			const uint runTextureCount = m_runTextures.size() - runTextureStart;
+			for(slot = 0; slot < runTextureCount && m_runTextures[runTextureStart + slot] != texture; ++slot);
+
+			if(slot == runTextureCount)
+			{
+				// Start a new run when all slots are taken
+				if(i == 0 || runTextureCount == slotCount)
+				{
+					runTextureStart = m_runTextures.size();
+					m_runStarts.push_back(i);
+					m_runTextureStarts.push_back(runTextureStart);
+					slot = 0;
+				}
+				m_runTextures.push_back(texture);
+			}
+		}
+
+		m_spriteTextureSlots[i] = (uchar) slot;
+	}
+
+	m_runStarts.push_back(m_spriteCount);
+	m_runTextureStarts.push_back(m_runTextures.size());
+}
+
+const uint64_t *SpriteBatch::sortSprites() const
+{
+	if(m_sortKeys.size() < m_spriteCount)
+	{
+		m_sortKeys.resize(m_spriteCount);
+		m_sortScratch.resize(m_spriteCount);
 	}
 
-	// For each depth
-	uint textureSwapCount = 0;
-	for(map<float, map<Texture2DPtr, list<Sprite*>>>::iterator itr1 = layerTextureMap.begin(); itr1 != layerTextureMap.end(); ++itr1)
+	switch(m_state.mode)
 	{
-		// For each texture
-		for(map<Texture2DPtr, list<Sprite*>>::iterator itr2 = itr1->second.begin(); itr2 != itr1->second.end(); ++itr2)
+		case DEFERRED:
+		{
+			// Sprites are not drawn until end() is called. end() will apply graphics
+			// device settings and draw all the sprites in one batch, sorted by depth
+			// and then texture, in the order calls to draw*() were recieved. This mode
+			// allows draw*() calls to two or more instances of SpriteBatch without
+			// introducing conflicting graphics device settings. SpriteBatch defaults
+			// to DEFERRED mode.
+
+			// Give each texture a slot in the order they first appear
+			m_textureSlots.clear();
+			const Texture2D *prevTexture = 0;
+			uint64_t textureSlot = 0;
+			for(uint i = 0; i < m_spriteCount; ++i)
+			{
+				const Sprite &sprite = m_sprites[i];
+				const Texture2D *texture = sprite.m_texture.get();
+				if(texture != prevTexture)
+				{
+					unordered_map<const Texture2D*, uint>::iterator itr = m_textureSlots.find(texture);
+					if(itr == m_textureSlots.end())
+					{
+						// Slots wrap around when there are too many textures. Runs are split
+						// on the actual texture, so this only costs extra draw calls.
+						textureSlot = m_textureSlots.size() & SORT_KEY_TEXTURE_MASK;
+						m_textureSlots[texture] = (uint) textureSlot;
+					}
+					else
+					{
+						textureSlot = itr->second;
+					}
+					prevTexture = texture;
+				}
+
+				m_sortKeys[i] = ((uint64_t) math::floatToSortKey(sprite.m_depth) << 32) | (textureSlot << SORT_KEY_TEXTURE_SHIFT) | i;
+			}
+		}
+		break;
+
+		case BACK_TO_FRONT:
+		case FRONT_TO_BACK:
+		{
+			// Sort sprites by depth only. Sprites with equal depth are drawn in the
+			// order they were recieved. As in DEFERRED mode, lower depths are at the back.
+			for(uint i = 0; i < m_spriteCount; ++i)
+			{
+				uint64_t depthKey = math::floatToSortKey(m_sprites[i].m_depth);
+				if(m_state.mode == FRONT_TO_BACK)
+				{
+					depthKey = ~depthKey & 0xFFFFFFFF;
+				}
+				m_sortKeys[i] = (depthKey << 32) | i;
+			}
+		}
+		break;
+
+		case TEXTURE:
+		{
+			// Sort sprites by texture. Draw forwards and batch together
+			// similar textures, as long as they don't overlap a different texture.
+			m_textureBatches.clear();
+			for(uint i = 0; i < m_spriteCount; ++i)
+			{
+				const Sprite &sprite = m_sprites[i];
+				const Texture2D *texture = sprite.m_texture.get();
+
+				// Get sprite bounds
+				Vector2 points[4];
+				sprite.getAABB(points);
+				Vector2 boundsMin = points[0], boundsMax = points[0];
+				for(uint j = 1; j < 4; ++j)
+				{
+					boundsMin.set(min(boundsMin.x, points[j].x), min(boundsMin.y, points[j].y));
+					boundsMax.set(max(boundsMax.x, points[j].x), max(boundsMax.y, points[j].y));
+				}
+
+				// Search backwards for a batch with the same texture. Stop if
+				// a batch in between overlaps the sprite.
+				int batchIndex = (int) m_textureBatches.size() - 1;
+				const int searchEnd = max(batchIndex - TEXTURE_BATCH_SEARCH_LIMIT, -1);
+				for(; batchIndex > searchEnd; --batchIndex)
+				{
+					const TextureBatch &batch = m_textureBatches[batchIndex];
+					if(batch.texture == texture)
+					{
+						break;
+					}
+
+					if(batch.boundsMin.x < boundsMax.x && boundsMin.x < batch.boundsMax.x &&
+						batch.boundsMin.y < boundsMax.y && boundsMin.y < batch.boundsMax.y)
+					{
+						batchIndex = searchEnd;
+						break;
+					}
+				}
+
+				if(batchIndex > searchEnd)
+				{
+					// Add sprite to the batch
+					TextureBatch &batch = m_textureBatches[batchIndex];
+					batch.boundsMin.set(min(batch.boundsMin.x, boundsMin.x), min(batch.boundsMin.y, boundsMin.y));
+					batch.boundsMax.set(max(batch.boundsMax.x, boundsMax.x), max(batch.boundsMax.y, boundsMax.y));
+				}
+				else
+				{
+					// Start a new batch
+					TextureBatch batch;
+					batch.texture = texture;
+					batch.boundsMin = boundsMin;
+					batch.boundsMax = boundsMax;
+					batchIndex = (int) m_textureBatches.size();
+					m_textureBatches.push_back(batch);
+				}
+
+				m_sortKeys[i] = ((uint64_t) batchIndex << SORT_KEY_TEXTURE_SHIFT) | i;
+			}
+		}
+		break;
+
+		case IMMEDIATE:
 		{
-			// If we have sprites
-			if(itr2->second.size() > 0)
+			// IMMEDIATE batches are drawn as they are recieved and never sorted.
+			// Keep submission order in case this is reached anyway.
+			for(uint i = 0; i < m_spriteCount; ++i)
 			{
-				++textureSwapCount;
+				m_sortKeys[i] = i;
 			}
 		}
+		break;
 	}
 
-	return textureSwapCount;
+	// Keys are created in submission order and the sort is stable, so the
+	// lower two bytes (mostly submission index) don't need their own passes
+	return math::radixSort(m_sortKeys.data(), m_sortScratch.data(), m_spriteCount, 2);
 }
 
 END_XD_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,197 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+BEGIN_XD_NAMESPACE
+
+SpriteCache::SpriteCache() :
+	m_vertexBuffer(0),
+	m_indexBuffer(0),
+	m_rebuild(false),
+	m_dirtyBegin(0),
+	m_dirtyEnd(0)
+{
+}
+
+SpriteCache::~SpriteCache()
+{
+	delete m_vertexBuffer;
+	delete m_indexBuffer;
+}
+
+uint SpriteCache::add(const Sprite &sprite)
+{
+	m_sprites.push_back(sprite);
+	m_rebuild = true;
+	return m_sprites.size() - 1;
+}
+
+void SpriteCache::set(const uint id, const Sprite &sprite)
+{
+	if(id >= m_sprites.size())
+	{
+		LOG("SpriteCache::set(): Sprite id %i out of range", id);
+		return;
+	}
+
+	Sprite &current = m_sprites[id];
+	if(!m_rebuild && current.m_texture == sprite.m_texture && current.m_depth == sprite.m_depth)
+	{
+		// The sprite keeps its place in the buffers, so only its vertices need updating
+		const uint slot = m_spriteSlots[id];
+		if(m_dirtyBegin == m_dirtyEnd)
+		{
+			m_dirtyBegin = slot;
+			m_dirtyEnd = slot + 1;
+		}
+		else
+		{
+			m_dirtyBegin = min(m_dirtyBegin, slot);
+			m_dirtyEnd = max(m_dirtyEnd, slot + 1);
+		}
+	}
+	else
+	{
+		m_rebuild = true;
+	}
+
+	current = sprite;
+}
+
+const Sprite &SpriteCache::get(const uint id) const
+{
+	return m_sprites[id];
+}
+
+void SpriteCache::clear()
+{
+	m_sprites.clear();
+	m_spriteSlots.clear();
+	m_slotSprites.clear();
+	m_groups.clear();
+	m_rebuild = false;
+	m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+void SpriteCache::draw(GraphicsContext &graphicsContext)
+{
+	if(m_rebuild)
+	{
+		rebuild();
+	}
+	else if(m_dirtyBegin != m_dirtyEnd)
+	{
+		patch();
+	}
+
+	if(m_sprites.empty())
+	{
+		return;
+	}
+
+	// Draw one range per texture group
+	Texture2DPtr prevTexture = graphicsContext.getTexture();
+	for(uint i = 0; i < m_groups.size(); ++i)
+	{
+		const TextureGroup &group = m_groups[i];
+		graphicsContext.setTexture(group.texture);
+		graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, m_vertexBuffer, m_indexBuffer, group.start * 6, group.count * 6);
+	}
+	graphicsContext.setTexture(prevTexture);
+}
+
+void SpriteCache::rebuild()
+{
+	const uint spriteCount = m_sprites.size();
+
+	// Order sprites by depth and then texture, in the order textures first appear
+	unordered_map<const Texture2D*, uint> textureSlots;
+	vector<uint64_t> keys(spriteCount);
+	for(uint i = 0; i < spriteCount; ++i)
+	{
+		const Texture2D *texture = m_sprites[i].m_texture.get();
+		unordered_map<const Texture2D*, uint>::iterator itr = textureSlots.find(texture);
+		uint64_t textureSlot;
+		if(itr != textureSlots.end())
+		{
+			textureSlot = itr->second;
+		}
+		else
+		{
+			const uint slot = textureSlots.size();
+			textureSlots[texture] = slot;
+			textureSlot = slot;
+		}
+		keys[i] = ((uint64_t) math::floatToSortKey(m_sprites[i].m_depth) << 32) | textureSlot;
+	}
+
+	m_slotSprites.resize(spriteCount);
+	for(uint i = 0; i < spriteCount; ++i)
+	{
+		m_slotSprites[i] = i;
+	}
+	stable_sort(m_slotSprites.begin(), m_slotSprites.end(), [&keys](const uint a, const uint b) { return keys[a] < keys[b]; });
+
+	// Bake vertices and find texture groups
+	vector<SpriteVertex> vertices(spriteCount * 4);
+	vector<uint> indices(spriteCount * 6);
+	m_spriteSlots.resize(spriteCount);
+	m_groups.clear();
+	for(uint slot = 0; slot < spriteCount; ++slot)
+	{
+		const uint id = m_slotSprites[slot];
+		const Sprite &sprite = m_sprites[id];
+		sprite.getVertices(&vertices[slot * 4], &indices[slot * 6], slot * 4);
+		m_spriteSlots[id] = slot;
+
+		if(m_groups.empty() || m_groups.back().texture != sprite.m_texture)
+		{
+			TextureGroup group;
+			group.texture = sprite.m_texture;
+			group.start = slot;
+			group.count = 0;
+			m_groups.push_back(group);
+		}
+		m_groups.back().count++;
+	}
+
+	// Upload buffers
+	if(spriteCount > 0)
+	{
+		if(!m_vertexBuffer)
+		{
+			m_vertexBuffer = new DynamicVertexBuffer();
+			m_indexBuffer = new StaticIndexBuffer();
+		}
+		m_vertexBuffer->setData(vertices.data(), vertices.size());
+		m_indexBuffer->setData(indices.data(), indices.size());
+	}
+
+	m_rebuild = false;
+	m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+void SpriteCache::patch()
+{
+	// Regenerate the vertices of the dirty slots only. Indices don't change.
+	const uint count = m_dirtyEnd - m_dirtyBegin;
+	vector<SpriteVertex> vertices(count * 4);
+	uint indices[6];
+	for(uint slot = m_dirtyBegin; slot < m_dirtyEnd; ++slot)
+	{
+		m_sprites[m_slotSprites[slot]].getVertices(&vertices[(slot - m_dirtyBegin) * 4], indices);
+	}
+
+	m_vertexBuffer->modifyData(m_dirtyBegin * 4, vertices.data(), vertices.size());
+	m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+END_XD_NAMESPACE
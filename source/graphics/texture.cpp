@@ -10,8 +10,6 @@
 #include <x2d/engine.h>
 #include <x2d/graphics.h>
 
-#include <freeimage.h>
-
 BEGIN_XD_NAMESPACE
 
 GLint toInternalFormat(PixelFormat::Components fmt, PixelFormat::DataType dt)
@@ -161,6 +159,7 @@ Texture2D::Texture2D(const Texture2D &texture)
 
 Texture2D::~Texture2D()
 {
+	GraphicsContext::releaseTexture(m_id);
 	glDeleteTextures(1, &m_id);
 }
 
@@ -241,9 +240,8 @@ Pixmap Texture2D::getPixmap() const
 {
 	// Get texture data
 	uchar *data = new uchar[m_width * m_height * m_pixelFormat.getPixelSizeInBytes()];
-	glBindTexture(GL_TEXTURE_2D, m_id);
+	GraphicsContext::bindTexture(m_id);
 	glGetTexImage(GL_TEXTURE_2D, 0, toFormat(m_pixelFormat.getComponents(), m_pixelFormat.getDataType()), toGLDataType(m_pixelFormat.getDataType()), (GLvoid*) data);
-	glBindTexture(GL_TEXTURE_2D, 0);
 
 	// Copy data to pixmap
 	Pixmap pixmap(m_width, m_height, data, m_pixelFormat);
@@ -258,9 +256,8 @@ void Texture2D::updatePixmap(const Pixmap &pixmap)
 	m_height = pixmap.getHeight();
 
 	// Set default filtering
-	glBindTexture(GL_TEXTURE_2D, m_id);
+	GraphicsContext::bindTexture(m_id);
 	glTexImage2D(GL_TEXTURE_2D, 0, toInternalFormat(pixmap.getFormat().getComponents(), pixmap.getFormat().getDataType()), (GLsizei) m_width, (GLsizei) m_height, 0, toFormat(pixmap.getFormat().getComponents(), pixmap.getFormat().getDataType()), toGLDataType(pixmap.getFormat().getDataType()), (const GLvoid*) pixmap.getData());
-	glBindTexture(GL_TEXTURE_2D, 0);
 
 	// Regenerate mipmaps
 	m_mipmapsGenerated = false;
@@ -273,9 +270,8 @@ void Texture2D::updatePixmap(const Pixmap &pixmap)
 void Texture2D::updatePixmap(const int x, const int y, const Pixmap &pixmap)
 {
 	// Set default filtering
-	glBindTexture(GL_TEXTURE_2D, m_id);
+	GraphicsContext::bindTexture(m_id);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, (GLint) x, (GLint) y, (GLsizei) pixmap.getWidth(), (GLsizei) pixmap.getHeight(), toFormat(pixmap.getFormat().getComponents(), pixmap.getFormat().getDataType()), toGLDataType(pixmap.getFormat().getDataType()), (const GLvoid*) pixmap.getData());
-	glBindTexture(GL_TEXTURE_2D, 0);
 
 	// Regenerate mipmaps
 	m_mipmapsGenerated = false;
@@ -287,24 +283,22 @@ void Texture2D::updatePixmap(const int x, const int y, const Pixmap &pixmap)
 
 void Texture2D::clear()
 {
-	glBindTexture(GL_TEXTURE_2D, m_id);
+	GraphicsContext::bindTexture(m_id);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_BGRA, GL_UNSIGNED_BYTE, vector<GLubyte>(m_width*m_height * 4, 0).data());
-	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Texture2D::updateFiltering()
 {
+	GraphicsContext::bindTexture(m_id);
 	if(m_mipmaps && !m_mipmapsGenerated)
 	{
 		glGenerateMipmap(GL_TEXTURE_2D);
 		m_mipmapsGenerated = true;
 	}
-	glBindTexture(GL_TEXTURE_2D, m_id);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_mipmaps ? (m_filter == GL_NEAREST ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR_MIPMAP_LINEAR) : m_filter);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_filter);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_wrapping);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_wrapping);
-	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 uint Texture2D::getWidth() const
@@ -319,24 +313,7 @@ uint Texture2D::getHeight() const
 
 void Texture2D::exportToFile(string path)
 {
-	// NOTE TO SELF: If I ever decide to implement export for integer texture, glGetTexImage() expects GL_BGRA_INTEGER instead of GL_BGRA
-	if(m_pixelFormat.getDataType() != PixelFormat::BYTE && m_pixelFormat.getDataType() != PixelFormat::UNSIGNED_BYTE)
-	{
-		LOG("Cannot export image with a pixel data type different from byte or unsigned byte");
-		return;
-	}
-
-	// Get texture data
-	uchar *data = new uchar[m_width * m_height * m_pixelFormat.getPixelSizeInBytes()];
-	glBindTexture(GL_TEXTURE_2D, m_id);
-	glGetTexImage(GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*) data);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	FIBITMAP *bitmap = FreeImage_ConvertFromRawBits(data, m_width, m_height, m_width * 4, 32, FI_RGBA_RED_MASK, FI_RGBA_GREEN, FI_RGBA_BLUE, false);
-	util::toAbsoluteFilePath(path);
-	FreeImage_Save(FIF_PNG, bitmap, path.c_str(), PNG_DEFAULT); // For now, let's just save everything as png
-
-	delete[] data;
+	Graphics::getFrameCapture().saveTexture(*this, path);
 }
 
 Texture2DPtr Texture2D::loadResource(const string &name)
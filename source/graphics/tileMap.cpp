@@ -0,0 +1,198 @@
+//       ____  ____     ____                        _____             _            
+// __  _|___ \|  _ \   / ___| __ _ _ __ ___   ___  | ____|_ __   __ _(_)_ __   ___ 
+// \ \/ / __) | | | | | |  _ / _  |  _   _ \ / _ \ |  _| |  _ \ / _  | |  _ \ / _ \
+//  >  < / __/| |_| | | |_| | (_| | | | | | |  __/ | |___| | | | (_| | | | | |  __/
+// /_/\_\_____|____/   \____|\__ _|_| |_| |_|\___| |_____|_| |_|\__, |_|_| |_|\___|
+//                                                              |___/     
+//				Originally written by Marcus Loo Vergara (aka. Bitsauce)
+//									2011-2014 (C)
+
+#include <x2d/engine.h>
+#include <x2d/graphics.h>
+
+BEGIN_XD_NAMESPACE
+
+TileMap::TileMap(const TextureAtlas *atlas, const uint width, const uint height, const float tileSize, const uint chunkSize) :
+	m_atlas(atlas),
+	m_width(width),
+	m_height(height),
+	m_tileSize(tileSize),
+	m_chunkSize(max(chunkSize, 1u)),
+	m_indexBuffer(0),
+	m_drawnChunkCount(0)
+{
+	m_chunksX = (m_width + m_chunkSize - 1) / m_chunkSize;
+	m_chunksY = (m_height + m_chunkSize - 1) / m_chunkSize;
+	m_chunks.resize(m_chunksX * m_chunksY);
+	for(uint i = 0; i < m_chunks.size(); ++i)
+	{
+		m_chunks[i].tiles.resize(m_chunkSize * m_chunkSize, (ushort) EMPTY_TILE);
+	}
+}
+
+TileMap::~TileMap()
+{
+	for(uint i = 0; i < m_chunks.size(); ++i)
+	{
+		delete m_chunks[i].vertexBuffer;
+	}
+	delete m_indexBuffer;
+}
+
+void TileMap::setTile(const uint x, const uint y, const ushort tile)
+{
+	if(x >= m_width || y >= m_height)
+	{
+		LOG("TileMap::setTile(): Tile (%i, %i) out of range", x, y);
+		return;
+	}
+
+	Chunk &chunk = m_chunks[(y / m_chunkSize) * m_chunksX + x / m_chunkSize];
+	ushort &current = chunk.tiles[(y % m_chunkSize) * m_chunkSize + x % m_chunkSize];
+	if(current != tile)
+	{
+		current = tile;
+		chunk.dirty = true;
+	}
+}
+
+ushort TileMap::getTile(const uint x, const uint y) const
+{
+	if(x >= m_width || y >= m_height)
+	{
+		return EMPTY_TILE;
+	}
+	return m_chunks[(y / m_chunkSize) * m_chunksX + x / m_chunkSize].tiles[(y % m_chunkSize) * m_chunkSize + x % m_chunkSize];
+}
+
+void TileMap::setAtlas(const TextureAtlas *atlas)
+{
+	m_atlas = atlas;
+	for(uint i = 0; i < m_chunks.size(); ++i)
+	{
+		m_chunks[i].dirty = true;
+	}
+}
+
+void TileMap::draw(GraphicsContext &graphicsContext)
+{
+	// The inverse model-view maps the viewport corners back to map coordinates
+	Matrix4 inverseView = graphicsContext.getModelViewMatrix();
+	inverseView.invert();
+
+	const float width = (float) graphicsContext.getWidth(), height = (float) graphicsContext.getHeight();
+	const Vector4 viewportCorners[4] = {
+		Vector4(0.0f, 0.0f, 0.0f, 1.0f),
+		Vector4(width, 0.0f, 0.0f, 1.0f),
+		Vector4(width, height, 0.0f, 1.0f),
+		Vector4(0.0f, height, 0.0f, 1.0f)
+	};
+
+	Vector2 viewMin = (inverseView * viewportCorners[0]).getXY(), viewMax = viewMin;
+	for(uint i = 1; i < 4; ++i)
+	{
+		const Vector2 corner = (inverseView * viewportCorners[i]).getXY();
+		viewMin.set(min(viewMin.x, corner.x), min(viewMin.y, corner.y));
+		viewMax.set(max(viewMax.x, corner.x), max(viewMax.y, corner.y));
+	}
+
+	draw(graphicsContext, Rect(viewMin, viewMax - viewMin));
+}
+
+void TileMap::draw(GraphicsContext &graphicsContext, const Rect &view)
+{
+	m_drawnChunkCount = 0;
+	if(!m_atlas || m_chunks.empty())
+	{
+		return;
+	}
+
+	// Find the range of chunks intersecting the view
+	const float chunkExtent = m_tileSize * m_chunkSize;
+	const int x0 = max((int) floor(view.getLeft() / chunkExtent), 0);
+	const int y0 = max((int) floor(view.getTop() / chunkExtent), 0);
+	const int x1 = min((int) ceil(view.getRight() / chunkExtent), (int) m_chunksX);
+	const int y1 = min((int) ceil(view.getBottom() / chunkExtent), (int) m_chunksY);
+
+	Texture2DPtr prevTexture = graphicsContext.getTexture();
+	graphicsContext.setTexture(m_atlas->getTexture());
+	for(int y = y0; y < y1; ++y)
+	{
+		for(int x = x0; x < x1; ++x)
+		{
+			// Chunks are baked when they are first seen after a change
+			Chunk &chunk = m_chunks[y * m_chunksX + x];
+			if(chunk.dirty)
+			{
+				bake(x, y);
+			}
+
+			if(chunk.quadCount > 0)
+			{
+				graphicsContext.drawIndexedPrimitives(GraphicsContext::PRIMITIVE_TRIANGLES, chunk.vertexBuffer, m_indexBuffer, 0, chunk.quadCount * 6);
+				++m_drawnChunkCount;
+			}
+		}
+	}
+	graphicsContext.setTexture(prevTexture);
+}
+
+void TileMap::bake(const uint chunkX, const uint chunkY)
+{
+	// Every chunk uses the same indices, so they are created once for a full chunk
+	const uint tilesPerChunk = m_chunkSize * m_chunkSize;
+	if(!m_indexBuffer)
+	{
+		vector<uint> indices(tilesPerChunk * 6);
+		for(uint i = 0; i < tilesPerChunk; ++i)
+		{
+			for(uint j = 0; j < 6; ++j)
+			{
+				indices[i * 6 + j] = i * 4 + QUAD_INDICES[j];
+			}
+		}
+		m_indexBuffer = new StaticIndexBuffer(indices.data(), indices.size());
+	}
+
+	// Write a quad per non-empty tile
+	Chunk &chunk = m_chunks[chunkY * m_chunksX + chunkX];
+	vector<SpriteVertex> vertices;
+	vertices.reserve(tilesPerChunk * 4);
+	for(uint y = 0; y < m_chunkSize; ++y)
+	{
+		for(uint x = 0; x < m_chunkSize; ++x)
+		{
+			const ushort tile = chunk.tiles[y * m_chunkSize + x];
+			if(tile == EMPTY_TILE)
+			{
+				continue;
+			}
+
+			const TextureRegion region = m_atlas->get(tile);
+			const float left = (chunkX * m_chunkSize + x) * m_tileSize, top = (chunkY * m_chunkSize + y) * m_tileSize;
+			const float right = left + m_tileSize, bottom = top + m_tileSize;
+
+			// Same corner order and texture coordinates as sprite quads
+			const SpriteVertex quad[4] = {
+				{ left, top, 0xFFFFFFFF, region.uv0.x, region.uv1.y, 0.0f },
+				{ right, top, 0xFFFFFFFF, region.uv1.x, region.uv1.y, 0.0f },
+				{ right, bottom, 0xFFFFFFFF, region.uv1.x, region.uv0.y, 0.0f },
+				{ left, bottom, 0xFFFFFFFF, region.uv0.x, region.uv0.y, 0.0f }
+			};
+			vertices.insert(vertices.end(), quad, quad + 4);
+		}
+	}
+
+	chunk.quadCount = vertices.size() / 4;
+	chunk.dirty = false;
+	if(chunk.quadCount > 0)
+	{
+		if(!chunk.vertexBuffer)
+		{
+			chunk.vertexBuffer = new StaticVertexBuffer();
+		}
+		chunk.vertexBuffer->setData(vertices.data(), vertices.size());
+	}
+}
+
+END_XD_NAMESPACE
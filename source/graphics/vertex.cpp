@@ -87,6 +87,20 @@ uint VertexFormat::getAttributeOffset(const VertexAttribute attrib) const
 	return m_attributes[attrib].offset;
 }
 
+uint VertexFormat::getHash() const
+{
+	// 3 bits of element count and 3 bits of data type per attribute
+	uint hash = 0;
+	for(int i = 0; i < VERTEX_ATTRIB_MAX; i++)
+	{
+		if(m_attributes[i].elementCount > 0)
+		{
+			hash |= (m_attributes[i].elementCount | ((m_attributes[i].dataType - XD_BYTE) << 3)) << (i * 6);
+		}
+	}
+	return hash;
+}
+
 bool VertexFormat::isAttributeEnabled(const VertexAttribute attrib) const
 {
 	return m_attributes[attrib].elementCount != 0;
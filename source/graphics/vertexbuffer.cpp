@@ -21,6 +21,7 @@ VertexBuffer::VertexBuffer(const BufferType type) :
 
 VertexBuffer::~VertexBuffer()
 {
+	GraphicsContext::releaseBuffer(m_id);
 	glDeleteBuffers(1, &m_id);
 }
 
@@ -35,15 +36,35 @@ void VertexBuffer::setData(const Vertex *vertices, const uint vertexCount)
 	}
 
 	// Upload vertex data
-	glBindBuffer(GL_ARRAY_BUFFER, m_id);
+	GraphicsContext::bindBuffer(GL_ARRAY_BUFFER, m_id);
 	glBufferData(GL_ARRAY_BUFFER, vertexCount * m_format.getVertexSizeInBytes(), vertexData, m_type);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	delete[] vertexData;
 
 	m_size = vertexCount;
 }
 
+void VertexBuffer::setData(const SpriteVertex *vertices, const uint vertexCount)
+{
+	// Sprite vertices are already packed in the sprite format
+	m_format = VertexFormat::s_vcts;
+
+	GraphicsContext::bindBuffer(GL_ARRAY_BUFFER, m_id);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(SpriteVertex), vertices, m_type);
+
+	m_size = vertexCount;
+}
+
+void VertexBuffer::setData(const VertexFormat &fmt, const void *vertices, const uint vertexCount)
+{
+	m_format = fmt;
+
+	GraphicsContext::bindBuffer(GL_ARRAY_BUFFER, m_id);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * m_format.getVertexSizeInBytes(), vertices, m_type);
+
+	m_size = vertexCount;
+}
+
 VertexFormat VertexBuffer::getVertexFormat() const
 {
 	return m_format;
@@ -71,13 +92,24 @@ void DynamicVertexBuffer::modifyData(const uint startIdx, Vertex *vertices, cons
 		vertices[i].getData(vertexData + i * m_format.getVertexSizeInBytes());
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_id);
+	GraphicsContext::bindBuffer(GL_ARRAY_BUFFER, m_id);
 	glBufferSubData(GL_ARRAY_BUFFER, startIdx * getVertexFormat().getVertexSizeInBytes(), vertexCount * getVertexFormat().getVertexSizeInBytes(), vertexData);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	delete[] vertexData;
 }
 
+void DynamicVertexBuffer::modifyData(const uint startIdx, const SpriteVertex *vertices, const uint vertexCount)
+{
+	if(!(m_format == VertexFormat::s_vcts))
+	{
+		LOG("DynamicVertexBuffer::modifyData(): Sprite vertices require the buffer to use the sprite vertex format");
+		return;
+	}
+
+	GraphicsContext::bindBuffer(GL_ARRAY_BUFFER, m_id);
+	glBufferSubData(GL_ARRAY_BUFFER, startIdx * sizeof(SpriteVertex), vertexCount * sizeof(SpriteVertex), vertices);
+}
+
 StaticVertexBuffer::StaticVertexBuffer() :
 	VertexBuffer(STATIC_BUFFER)
 {
@@ -100,15 +132,15 @@ IndexBuffer::IndexBuffer(const BufferType type) :
 
 IndexBuffer::~IndexBuffer()
 {
+	GraphicsContext::releaseBuffer(m_id);
 	glDeleteBuffers(1, &m_id);
 }
 
 void IndexBuffer::setData(const uint *indices, const uint indexCount)
 {
 	// Upload index data
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_id);
+	GraphicsContext::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_id);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint), indices, m_type);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	
 	m_size = indexCount;
 }
@@ -126,9 +158,8 @@ DynamicIndexBuffer::DynamicIndexBuffer(const uint *indices, const uint indexCoun
 
 void DynamicIndexBuffer::modifyData(const uint startIdx, uint *indices, const uint indexCount)
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_id);
+	GraphicsContext::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_id);
 	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, startIdx * sizeof(uint), indexCount * sizeof(uint), indices);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 StaticIndexBuffer::StaticIndexBuffer() :
@@ -142,4 +173,137 @@ StaticIndexBuffer::StaticIndexBuffer(const uint *indices, const uint indexCount)
 	setData(indices, indexCount);
 }
 
+
+// -------------------------------------------------------------------------------------
+
+StreamBuffer::StreamBuffer(const GLenum target, const uint size) :
+	m_target(target),
+	m_size(size),
+	m_head(0),
+	m_fenceBegin(0),
+	m_useFences(Graphics::isGLVersionSupported(3, 2)),
+	m_fallbackOffset(0),
+	m_fallbackMapped(false),
+	m_mapFailed(false)
+{
+	glGenBuffers(1, &m_id);
+	GraphicsContext::bindBuffer(m_target, m_id);
+	glBufferData(m_target, m_size, 0, GL_STREAM_DRAW);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for(uint i = 0; i < m_fences.size(); ++i)
+	{
+		glDeleteSync(m_fences[i].sync);
+	}
+	GraphicsContext::releaseBuffer(m_id);
+	glDeleteBuffers(1, &m_id);
+}
+
+void *StreamBuffer::map(const uint size, const uint alignment, uint &offset)
+{
+	// Grow the buffer if the data doesn't fit at all
+	if(size > m_size)
+	{
+		while(m_size < size) m_size *= 2;
+		orphan();
+	}
+
+	offset = (m_head + alignment - 1) / alignment * alignment;
+	if(offset + size > m_size)
+	{
+		// Wrap around
+		if(m_useFences)
+		{
+			fence();
+			m_head = m_fenceBegin = 0;
+		}
+		else
+		{
+			orphan();
+		}
+		offset = 0;
+	}
+
+	waitForRange(offset, offset + size);
+
+	GraphicsContext::bindBuffer(m_target, m_id);
+	void *data = GL_CALL(glMapBufferRange(m_target, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	m_head = offset + size;
+	if(!data)
+	{
+		// Write to system memory and upload the data on unmap()
+		if(!m_mapFailed)
+		{
+			LOG("StreamBuffer::map(): glMapBufferRange() failed, falling back to glBufferSubData()");
+			m_mapFailed = true;
+		}
+		m_fallbackData.resize(size);
+		m_fallbackOffset = offset;
+		m_fallbackMapped = true;
+		data = m_fallbackData.data();
+	}
+	return data;
+}
+
+void StreamBuffer::unmap()
+{
+	GraphicsContext::bindBuffer(m_target, m_id);
+	if(m_fallbackMapped)
+	{
+		GL_CALL(glBufferSubData(m_target, m_fallbackOffset, m_fallbackData.size(), m_fallbackData.data()));
+		m_fallbackMapped = false;
+		return;
+	}
+	GL_CALL(glUnmapBuffer(m_target));
+}
+
+void StreamBuffer::fence()
+{
+	if(m_useFences && m_head > m_fenceBegin)
+	{
+		Fence fence = { GL_CALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)), m_fenceBegin, m_head };
+		m_fences.push_back(fence);
+		m_fenceBegin = m_head;
+	}
+}
+
+void StreamBuffer::orphan()
+{
+	for(uint i = 0; i < m_fences.size(); ++i)
+	{
+		glDeleteSync(m_fences[i].sync);
+	}
+	m_fences.clear();
+
+	GraphicsContext::bindBuffer(m_target, m_id);
+	GL_CALL(glBufferData(m_target, m_size, 0, GL_STREAM_DRAW));
+	m_head = m_fenceBegin = 0;
+}
+
+void StreamBuffer::waitForRange(const uint begin, const uint end)
+{
+	// Fences signal in order, so waiting for the newest overlapping fence
+	// also completes every fence before it
+	int last = -1;
+	for(uint i = 0; i < m_fences.size(); ++i)
+	{
+		if(m_fences[i].begin < end && begin < m_fences[i].end)
+		{
+			last = i;
+		}
+	}
+
+	for(int i = 0; i <= last; ++i)
+	{
+		if(i == last)
+		{
+			while(GL_CALL(glClientWaitSync(m_fences.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000)) == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(m_fences.front().sync);
+		m_fences.pop_front();
+	}
+}
+
 END_XD_NAMESPACE
\ No newline at end of file